@@ -64,29 +64,29 @@ void init(multiboot_info_t *mbi, uint32_t magic)
     boot_info_t *info = boot_create_info(mbi);
     
     // Print info
-    console_print("Loader: ");
-    console_print((int8_t *) (uintptr_t) info->loader_name);
+    console_debug("Loader: ");
+    console_debug((int8_t *) (uintptr_t) info->loader_name);
     
-    console_print("\nCommand: ");
-    console_print((int8_t *) (uintptr_t) info->args);
-    console_print("\n");
-    console_print(separator);
+    console_debug("\nCommand: ");
+    console_debug((int8_t *) (uintptr_t) info->args);
+    console_debug("\n");
+    console_debug(separator);
     
     // Get end address (page aligned)
     uintptr_t endAddress = mem_align((uintptr_t) &end, 0x1000);
     uintptr_t placement = endAddress;
     
     // Relocate modules
-    console_print("[LOADER] Relocating modules...\n");
+    console_debug("[LOADER] Relocating modules...\n");
     placement = boot_modules_relocate(info, placement);
     
     // Find kernel module
-    console_print("[LOADER] Searching for kernel...\n");
+    console_debug("[LOADER] Searching for kernel...\n");
     
     boot_info_mod_t *module = (boot_info_mod_t *) (uintptr_t) info->mods;
     boot_info_mod_t *kernel = 0;
     while (0 != module) {
-        if (strcmp((int8_t *) (uintptr_t) module->name, "/boot/kernel64.bin")) {
+        if (0 == strcmp((int8_t *) (uintptr_t) module->name, "/boot/kernel64.bin")) {
             kernel = module;
             break;
         }
@@ -101,15 +101,15 @@ void init(multiboot_info_t *mbi, uint32_t magic)
     }
     
     // Setup paging
-    console_print("[LOADER] Setting up paging...\n");
+    console_debug("[LOADER] Setting up paging...\n");
     boot_page_setup((uintptr_t) info);
     
     // Load the kernel
-    console_print("[LOADER] Loading kernel from ");
-    console_print_hex(kernel->address);
-    console_print(" to ");
-    console_print_hex(placement);
-    console_print("...\n");
+    console_debug("[LOADER] Loading kernel from ");
+    console_debug_hex(kernel->address);
+    console_debug(" to ");
+    console_debug_hex(placement);
+    console_debug("...\n");
     
     boot_load_result_t load_res = boot_load_kernel_elf64(
         placement, kernel->address, kernel->length);
@@ -119,9 +119,9 @@ void init(multiboot_info_t *mbi, uint32_t magic)
     cpu_gdt_init();
     
     // Create long mode trampoline
-    console_print("[LOADER] Creating trampoline code at ");
-    console_print_hex((uintptr_t) &realm64);
-    console_print("...\n");
+    console_debug("[LOADER] Creating trampoline code at ");
+    console_debug_hex((uintptr_t) &realm64);
+    console_debug("...\n");
     
     uint8_t *trampoline = (uint8_t *) (uintptr_t) (&realm64);
     trampoline[0] = 0x48; // mov
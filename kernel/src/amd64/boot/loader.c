@@ -43,17 +43,22 @@ boot_load_result_t boot_load_kernel_elf64(uintptr_t target, uint64_t address, ui
     Elf64_Phdr *elf_phdr = (Elf64_Phdr *) (uintptr_t) (address + elf_hdr->e_phoff);
     size_t i;
     
+    // Offset between virtual and load addresses (segments like the per-CPU
+    // template are linked at a different address than they are mapped at)
+    uint64_t vma_offset = 0;
+    bool vma_offset_set = false;
+    
     for (i = 0; i < elf_hdr->e_phnum; ++i) {
         // Only loadable segments are supported (and required)
         if (PT_LOAD == elf_phdr->p_type) {
             // Debug
-            console_print("[ELF64] Loadable segment found at offset ");
-            console_print_hex((uintptr_t) elf_phdr->p_offset);
-            console_print("\n[ELF64] Memsz: ");
-            console_print_hex((uintptr_t) elf_phdr->p_memsz);
-            console_print("  Filesz: ");
-            console_print_hex((uintptr_t) elf_phdr->p_filesz);
-            console_print("\n");
+            console_debug("[ELF64] Loadable segment found at offset ");
+            console_debug_hex((uintptr_t) elf_phdr->p_offset);
+            console_debug("\n[ELF64] Memsz: ");
+            console_debug_hex((uintptr_t) elf_phdr->p_memsz);
+            console_debug("  Filesz: ");
+            console_debug_hex((uintptr_t) elf_phdr->p_filesz);
+            console_debug("\n");
                 
             // Page flags
             uint64_t flags = PG_PRESENT | PG_GLOBAL;
@@ -61,16 +66,22 @@ boot_load_result_t boot_load_kernel_elf64(uintptr_t target, uint64_t address, ui
             if (elf_phdr->p_flags & PF_W)
                 flags |= PG_WRITABLE;
                 
-            // Map segment
+            // Map segment at its load address
             uint64_t off;
             
+            if (!vma_offset_set) {
+                vma_offset = elf_phdr->p_vaddr - elf_phdr->p_paddr;
+                vma_offset_set = true;
+            }
+            
             for (off = 0; off < elf_phdr->p_memsz; off += 0x1000)
-                boot_page_map(target + off, elf_phdr->p_vaddr + off, flags);
+                boot_page_map(
+                    target + off, elf_phdr->p_paddr + vma_offset + off, flags);
                 
             // Copy bytes
-            console_print("[ELF64] Copying ");
-            console_print_hex((uintptr_t) elf_phdr->p_filesz);
-            console_print(" bytes from binary...\n");
+            console_debug("[ELF64] Copying ");
+            console_debug_hex((uintptr_t) elf_phdr->p_filesz);
+            console_debug(" bytes from binary...\n");
             
             memcpy(
                 (void *) target,
@@ -80,9 +91,9 @@ boot_load_result_t boot_load_kernel_elf64(uintptr_t target, uint64_t address, ui
             // Fill the rest with zeroes
             size_t fill_len = (size_t) (elf_phdr->p_memsz - elf_phdr->p_filesz);
             
-            console_print("[ELF64] Reserving ");
-            console_print_hex(elf_phdr->p_memsz - elf_phdr->p_filesz);
-            console_print(" bytes...\n");
+            console_debug("[ELF64] Reserving ");
+            console_debug_hex(elf_phdr->p_memsz - elf_phdr->p_filesz);
+            console_debug(" bytes...\n");
             
             memset(
                 (void *) (uintptr_t) (target + elf_phdr->p_filesz), 0,
@@ -93,16 +104,16 @@ boot_load_result_t boot_load_kernel_elf64(uintptr_t target, uint64_t address, ui
             
         } else {
             // Debug
-            console_print("[ELF64] Non-loadable segment found at offset ");
-            console_print_hex((uintptr_t) elf_phdr->p_offset);
-            console_print("\n");
+            console_debug("[ELF64] Non-loadable segment found at offset ");
+            console_debug_hex((uintptr_t) elf_phdr->p_offset);
+            console_debug("\n");
         }
             
         // Next header
         elf_phdr = (Elf64_Phdr *) (((uintptr_t) elf_phdr) + elf_hdr->e_phentsize);
     }
     
-    console_print("[ELF64] Binary loaded.\n");
+    console_debug("[ELF64] Binary loaded.\n");
     
     // Return entry point address
     boot_load_result_t result = {elf_hdr->e_entry, target_bak, target};
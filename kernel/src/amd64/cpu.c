@@ -24,41 +24,139 @@
 #include <api/memory/heap.h>
 #include <api/memory/page.h>
 
+#include <api/multitasking/thread.h>
+
 #include <amd64/cpu.h>
+#include <amd64/cpu/features.h>
+#include <amd64/cpu/defer.h>
+#include <amd64/cpu/fpu.h>
 #include <amd64/cpu/int.h>
 #include <amd64/cpu/ipi.h>
 #include <amd64/cpu/pic.h>
+#include <amd64/cpu/ioapic.h>
+#include <amd64/cpu/hpet.h>
+#include <amd64/cpu/idle.h>
 #include <amd64/cpu/lapic.h>
+#include <amd64/cpu/percpu.h>
 #include <amd64/cpu/timer.h>
+#include <amd64/cpu/tlb.h>
+#include <amd64/cpu/topology.h>
 
 #include <amd64/io/io.h>
 
+#include <amd64/util/time.h>
+
 #include <api/cpu/int.h>
+#include <api/util/time.h>
 
 #include <api/debug/console.h>
 
+//----------------------------------------------------------------------------//
+// CPU - Constants
+//----------------------------------------------------------------------------//
+
+/**
+ * Locations in the SMP trampoline's data page (physical).
+ */
+#define CPU_SMP_TRAMPOLINE          0x1000
+#define CPU_SMP_GDT64_PTR           0x1C00
+#define CPU_SMP_ENTRY_POINT         0x1C06
+#define CPU_SMP_STACKS              0x1C30
+#define CPU_SMP_STACK_NEXT          0x1C38
+
+/**
+ * Size of the stack each AP starts on.
+ */
+#define CPU_SMP_STACK_SIZE          0x4000
+
+/**
+ * Size of the CPU id map; kept at most a quarter full for short probes.
+ */
+#define CPU_INDEX_MAP_SIZE          (4 * MAX_CPUS)
+
+/**
+ * Delays of the INIT-SIPI-SIPI sequence and the time to wait for all APs to
+ * report (in microseconds).
+ */
+#define CPU_SMP_INIT_DELAY          10000
+#define CPU_SMP_SIPI_DELAY          200
+#define CPU_SMP_TIMEOUT             100000
+
 //----------------------------------------------------------------------------//
 // CPU - Variables
 //----------------------------------------------------------------------------//
 
-static cpu_t *cpu_first = 0;
-static cpu_t *cpu_last = 0;
-static size_t cpu_list_len = 0;
+/**
+ * The CPUs, indexed by their logical number.
+ */
+static cpu_t cpu_table[MAX_CPUS];
+static size_t cpu_table_len = 0;
+
+/**
+ * Open addressing hash map from CPU ids to logical numbers (plus one; zero
+ * marks empty slots).
+ */
+static uint16_t cpu_index_map[CPU_INDEX_MAP_SIZE];
 
 /**
  * Location of SMP trampoline in this binary (virtual).
  */
 extern uint8_t cpu_smp_trampoline;
 
+/**
+ * Number of APs that have completed their startup.
+ */
+static volatile uint32_t cpu_smp_started = 0;
+
+/**
+ * Number of APs that have been parked, as they lack required features.
+ */
+static volatile uint32_t cpu_smp_parked = 0;
+
 //----------------------------------------------------------------------------//
 // CPU - Internal
 //----------------------------------------------------------------------------//
 
+/**
+ * Returns the slot of the CPU id map to start probing at for the given id.
+ *
+ * @param id The CPU's id.
+ * @return The slot.
+ */
+static size_t _cpu_index_slot(cpu_id_t id)
+{
+    return ((uint64_t) id * 2654435761U) % CPU_INDEX_MAP_SIZE;
+}
+
 /**
  * Entry point APs will jump to after initialization.
  */
 static void _cpu_smp_entry_point(void)
 {
+    // Switch LAPIC mode like the BSP
+    cpu_lapic_mode_init();
+    
+    // Load per-CPU data area
+    cpu_percpu_load();
+    
+    // Detect features
+    cpu_t *cpu = cpu_current();
+    cpu->features = cpu_features_detect();
+    
+    // Code patched for the BSP may not run here: park without being counted
+    if (!cpu_features_check(cpu)) {
+        __sync_fetch_and_add(&cpu_smp_parked, 1);
+        
+        while (1)
+            asm volatile ("cli; hlt");
+    }
+    
+    // Let RDTSCP return this CPU's logical number
+    cpu_tsc_load();
+    
+    // Enable FPU, SSE and XSAVE
+    cpu_fpu_load();
+    
     // Load IDT
     cpu_int_load();
     
@@ -74,11 +172,15 @@ static void _cpu_smp_entry_point(void)
     // Initialize timer
     cpu_timer_init(false);
     
-    // Set init flag
-    cpu_get(cpu_current_id())->flags |= CPU_FLAG_INIT;
+    // Set init flag and report to the BSP
+    cpu->flags |= CPU_FLAG_INIT;
+    __sync_fetch_and_add(&cpu_smp_started, 1);
+    
+    // Let BSP measure TSC offset
+    time_sync_ap();
     
-    // Trap in infinite loop
-    while (1);
+    // Become the CPU's idle thread
+    thread_idle();
 }
 
 //----------------------------------------------------------------------------//
@@ -87,10 +189,37 @@ static void _cpu_smp_entry_point(void)
 
 void cpu_startup(void)
 {
+    // Use x2APIC mode, if supported
+    cpu_lapic_mode_init();
+    
+    // Allocate per-CPU data areas
+    cpu_percpu_init();
+    
     // Mark current processor as BSP
-    cpu_t *bsp = cpu_get(cpu_current_id());
+    cpu_t *bsp = cpu_current();
     bsp->flags |= CPU_FLAG_BSP | CPU_FLAG_INIT;
     
+    // Detect features
+    bsp->features = cpu_features_detect();
+    
+    // Determine which CPUs share cores and packages
+    cpu_topology_init();
+    
+    // Enable FPU, SSE and XSAVE with lazy state switching
+    cpu_fpu_init();
+    
+    // Select how idle CPUs sleep
+    cpu_idle_init();
+    
+    // Start recording interrupt statistics
+    cpu_int_stats_init();
+    
+    // Allocate deferred work queues
+    cpu_defer_init();
+    
+    // Handle TLB shootdowns
+    cpu_tlb_init();
+    
     // Initialize PIC
     cpu_pic_init();
     
@@ -100,137 +229,212 @@ void cpu_startup(void)
     // Enable the BSP's LAPIC
     cpu_lapic_enable();
     
+    // Start HPET as calibration reference
+    cpu_hpet_init();
+    
     // Initialize timer
     cpu_timer_init(true);
     
+    // Start clocksource
+    time_clock_init();
+    
     // Disable PIC
     cpu_pic_disable();
+    
+    // Mask all I/O APIC inputs until they are routed
+    cpu_ioapic_init();
 }
 
 void cpu_add(cpu_t cpu)
 {
-    // Increase list length
-    ++cpu_list_len;
-
+    // Table full?
+    if (cpu_table_len >= MAX_CPUS) {
+        console_print("[SMP ] Ignoring CPU ");
+        console_print_hex(cpu.id);
+        console_print(" (build with a larger MAX_CPUS)\n");
+        return;
+    }
+    
     // Copy cpu structure
-    cpu_t *_cpu = (cpu_t *) malloc(sizeof(cpu_t));
+    cpu_t *_cpu = &cpu_table[cpu_table_len];
     memcpy(_cpu, &cpu, sizeof(cpu_t));
-
-    // Add to cpu list
-    if (0 == cpu_first)
-        cpu_first = cpu_last = _cpu;
-    else {
-        cpu_last->next = _cpu;
-        cpu_last = _cpu;
-    }
+    _cpu->index = cpu_table_len++;
+    
+    // Map id to logical number
+    size_t slot = _cpu_index_slot(cpu.id);
+    
+    while (0 != cpu_index_map[slot])
+        slot = (slot + 1) % CPU_INDEX_MAP_SIZE;
+        
+    cpu_index_map[slot] = _cpu->index + 1;
 }
 
 cpu_t *cpu_get(cpu_id_t id)
 {
-    cpu_t *current = cpu_get_first();
+    size_t slot = _cpu_index_slot(id);
     
-    while (0 != current) {
+    while (0 != cpu_index_map[slot]) {
+        cpu_t *cpu = &cpu_table[cpu_index_map[slot] - 1];
+        
         // CPU we're looking for?
-        if (id == current->id)
-            return current;
+        if (id == cpu->id)
+            return cpu;
             
-        // Next one
-        current = current->next;
+        slot = (slot + 1) % CPU_INDEX_MAP_SIZE;
     }
     
     return 0;
 }
 
-cpu_t *cpu_get_first(void)
+cpu_t *cpu_get_index(size_t index)
 {
-    return cpu_first;
+    return (index < cpu_table_len) ? &cpu_table[index] : 0;
 }
 
 size_t cpu_count(void)
 {
-    return cpu_list_len;
+    return cpu_table_len;
 }
 
 cpu_id_t cpu_current_id(void)
 {
-    return (*LAPIC_REGISTER(LAPIC_ID_OFFSET) >> 24) & 0xFF;
+    return percpu_read(cpu_percpu_id);
+}
+
+cpu_t *cpu_current(void)
+{
+    return percpu_read(cpu_percpu_cpu);
+}
+
+size_t cpu_current_index(void)
+{
+    return percpu_read(cpu_percpu_index);
 }
 
 //----------------------------------------------------------------------------//
 // CPU - SMP
 //----------------------------------------------------------------------------//
 
+/**
+ * Checks whether the given CPU is an enabled AP.
+ *
+ * @param cpu The CPU.
+ * @return Whether the CPU is to be started.
+ */
+static bool _cpu_smp_is_ap(cpu_t *cpu)
+{
+    return !(cpu->flags & CPU_FLAG_BSP) && (cpu->flags & CPU_FLAG_ENABLED);
+}
+
+/**
+ * Sends a startup IPI to all enabled APs that have not been initialized yet.
+ */
+static void _cpu_smp_sipi(void)
+{
+    size_t i;
+    
+    for (i = 0; i < cpu_count(); ++i) {
+        cpu_t *cpu = cpu_get_index(i);
+        
+        if (_cpu_smp_is_ap(cpu) && !(((volatile cpu_t *) cpu)->flags & CPU_FLAG_INIT))
+            cpu_ipi_startup(CPU_SMP_TRAMPOLINE, cpu->id);
+    }
+}
+
 void cpu_smp_init(void)
 {
     // Get BSP
-    cpu_t *bsp = cpu_get(cpu_current_id());
+    cpu_t *bsp = cpu_current();
+    size_t i;
     
-    // Wait some time
-    size_t i = 0;
-    for (i = 0; i < 0xFFFFF; ++i);
-
     // Load trampoline code
     memcpy(
-        (void *) 0x1000,
+        (void *) CPU_SMP_TRAMPOLINE,
         (void *) (uintptr_t) (&cpu_smp_trampoline),
         0x1000);
     
     // GDT
     memcpy(
-        (void *) 0x1C00,
+        (void *) CPU_SMP_GDT64_PTR,
         (void *) 0xFFFFFF7FFFFFD028,
         0x6);
         
     // Entry point
-    *((uint64_t *) 0x1C06) = (uint64_t) (&_cpu_smp_entry_point);
+    *((uint64_t *) CPU_SMP_ENTRY_POINT) = (uint64_t) (&_cpu_smp_entry_point);
     
-    // Boot APs
-    cpu_t *cpu = cpu_get_first();
+    // Allocate a stack per AP, taken by the APs in the order they start
+    uint32_t expected = 0;
     
-    while (0 != cpu) {
-        // Is AP and enabled??
-        if (cpu->flags & CPU_FLAG_BSP | !(cpu->flags & CPU_FLAG_ENABLED)) {
-            cpu = cpu->next;
-            continue;
-        }
+    for (i = 0; i < cpu_count(); ++i)
+        if (_cpu_smp_is_ap(cpu_get_index(i)))
+            ++expected;
+            
+    if (0 == expected)
+        return;
         
-        // Send init ipi
-        cpu_ipi(
-            0,                          // Vector
-            cpu->id,                    // Destination
-            IPI_DEST_DEST_FIELD,        // Destination shorthand
-            IPI_MODE_PHYSICAL,          // Destination mode
-            IPI_DELIVERY_INIT,          // Delivery mode
-            IPI_LEVEL_ASSERT,           // Level
-            bsp);                       // Current CPI
-    
-        // Send first startup ipi
-        cpu_ipi_startup(0x1000, cpu->id);
+    uintptr_t *stacks = (uintptr_t *) malloc(sizeof(uintptr_t) * expected);
+    
+    for (i = 0; i < expected; ++i)
+        stacks[i] = (uintptr_t) malloc(CPU_SMP_STACK_SIZE) + CPU_SMP_STACK_SIZE;
         
-        // Wait
-        for (i = 0; i < 0xFFFFF & !(cpu->flags & CPU_FLAG_INIT); ++i);
+    *((uint64_t *) CPU_SMP_STACKS) = (uint64_t) (uintptr_t) stacks;
+    *((uint64_t *) CPU_SMP_STACK_NEXT) = 0;
+    
+#ifdef __DEBUG__
+    // Start time for the startup duration report
+    uint64_t begin = time_monotonic_ns();
+#endif
+    
+    // Send INIT to all APs at once, then two rounds of startup IPIs
+    for (i = 0; i < cpu_count(); ++i) {
+        cpu_t *cpu = cpu_get_index(i);
         
-        // Initialized now?
-        if (!(cpu->flags & CPU_FLAG_INIT))
-            // Retry startup ipi
-            cpu_ipi_startup(0x1000, cpu->id);
-            
-        // Wait
-        for (i = 0; i < 0xFFFFFF & !(cpu->flags & CPU_FLAG_INIT); ++i);
+        if (_cpu_smp_is_ap(cpu))
+            cpu_ipi(
+                0,                          // Vector
+                cpu->id,                    // Destination
+                IPI_DEST_DEST_FIELD,        // Destination shorthand
+                IPI_MODE_PHYSICAL,          // Destination mode
+                IPI_DELIVERY_INIT,          // Delivery mode
+                IPI_LEVEL_ASSERT,           // Level
+                bsp);                       // Current CPU
+    }
+    
+    udelay(CPU_SMP_INIT_DELAY);
+    _cpu_smp_sipi();
+    udelay(CPU_SMP_SIPI_DELAY);
+    _cpu_smp_sipi();
+    
+    // Wait for all APs to report or the timeout to pass
+    uint64_t timeout = time_monotonic_ns() + CPU_SMP_TIMEOUT * 1000ULL;
+    
+    while (cpu_smp_started + cpu_smp_parked < expected && time_monotonic_ns() < timeout)
+        asm volatile ("pause");
+        
+    console_debug("[SMP ] Started ");
+    console_debug_dec(cpu_smp_started);
+    console_debug(" APs in ");
+    console_debug_dec((time_monotonic_ns() - begin) / 1000);
+    console_debug(" us\n");
+    
+    // Synchronize the clocksources of the started APs
+    for (i = 0; i < cpu_count(); ++i) {
+        cpu_t *cpu = cpu_get_index(i);
         
-        // Intiailized now?
-        if (!(cpu->flags & CPU_FLAG_INIT)) {
+        if (!_cpu_smp_is_ap(cpu))
+            continue;
+            
+        if (!(((volatile cpu_t *) cpu)->flags & CPU_FLAG_INIT)) {
             console_print("[SMP ] Failed to initialize AP ");
             console_print_hex(cpu->id);
             console_print("\n");
-        } else {
-            // Print message
-            console_print("[SMP ] Application Processor ");
-            console_print_hex(cpu->id);
-            console_print(" initialized.\n");
+            continue;
         }
         
-        // Next
-        cpu = cpu->next;
+        console_debug("[SMP ] Application Processor ");
+        console_debug_hex(cpu->id);
+        console_debug(" initialized.\n");
+        
+        time_sync_bsp(cpu->id);
     }
 }
@@ -65,3 +65,130 @@ void cpu_set_cr3(uintptr_t cr3);
  * @return The value of the register.
  */
 uintptr_t cpu_get_cr3(void);
+
+/**
+ * Sets the value of the <tt>CR0</tt> register.
+ *
+ * @param cr0 New value for the register.
+ */
+void cpu_set_cr0(uintptr_t cr0);
+
+/**
+ * Returns the value of the <tt>CR0</tt> register.
+ *
+ * @return The value of the register.
+ */
+uintptr_t cpu_get_cr0(void);
+
+/**
+ * Sets the value of the <tt>CR4</tt> register.
+ *
+ * @param cr4 New value for the register.
+ */
+void cpu_set_cr4(uintptr_t cr4);
+
+/**
+ * Returns the value of the <tt>CR4</tt> register.
+ *
+ * @return The value of the register.
+ */
+uintptr_t cpu_get_cr4(void);
+
+//----------------------------------------------------------------------------//
+// CPU - Time Stamp Counter
+//----------------------------------------------------------------------------//
+
+/**
+ * Returns the current value of the processor's time stamp counter.
+ *
+ * @return The number of cycles counted by the TSC.
+ */
+uint64_t cpu_tsc_read(void);
+
+/**
+ * Reads the time stamp counter after all preceding instructions completed.
+ *
+ * @return The number of cycles counted by the TSC.
+ */
+uint64_t cpu_tsc_read_ordered(void);
+
+/**
+ * Reads the time stamp counter along with the logical number of the CPU it
+ * has been read on.
+ *
+ * Uses RDTSCP once <tt>cpu_tsc_load</tt> has run; otherwise the number is read
+ * after the TSC, so callers compare it with the one read before to detect
+ * migrations.
+ *
+ * @param index Receives the CPU's logical number.
+ * @return The number of cycles counted by the TSC.
+ */
+uint64_t cpu_tsc_read_index(size_t *index);
+
+/**
+ * Stores the current CPU's logical number in <tt>IA32_TSC_AUX</tt> for RDTSCP,
+ * if supported.
+ *
+ * To be called on each CPU once its per-CPU data area is loaded and its
+ * features have been checked.
+ */
+void cpu_tsc_load(void);
+
+/**
+ * Determines the TSC's frequency, preferring the one enumerated by CPUID
+ * (leaves 0x15 and 0x16) over the given measurement.
+ *
+ * @param measured_hz The frequency measured against a reference timer.
+ * @return The TSC's frequency in Hz.
+ */
+uint64_t cpu_tsc_calibrate(uint64_t measured_hz);
+
+/**
+ * Returns the TSC's frequency.
+ *
+ * @return The frequency in Hz or <tt>0</tt>, if not yet calibrated.
+ */
+uint64_t cpu_tsc_frequency(void);
+
+//----------------------------------------------------------------------------//
+// CPU - Model Specific Registers
+//----------------------------------------------------------------------------//
+
+/**
+ * Reads the given model specific register.
+ *
+ * @param msr The number of the MSR.
+ * @return The MSR's value.
+ */
+uint64_t cpu_msr_read(uint32_t msr);
+
+/**
+ * Writes the given model specific register.
+ *
+ * @param msr The number of the MSR.
+ * @param value The value to write.
+ */
+void cpu_msr_write(uint32_t msr, uint64_t value);
+
+//----------------------------------------------------------------------------//
+// CPU - CPUID
+//----------------------------------------------------------------------------//
+
+/**
+ * Registers returned by the <tt>CPUID</tt> instruction.
+ */
+typedef struct cpu_cpuid_t
+{
+    uint32_t eax, ebx, ecx, edx;
+} cpu_cpuid_t;
+
+/**
+ * Executes the <tt>CPUID</tt> instruction for the given leaf and subleaf.
+ *
+ * Leaves above the processor's maximum supported leaf return all zeroes.
+ *
+ * @param leaf The leaf to query (<tt>EAX</tt>).
+ * @param subleaf The subleaf to query (<tt>ECX</tt>).
+ * @param regs Structure to store the resulting registers in.
+ */
+void cpu_cpuid(uint32_t leaf, uint32_t subleaf, cpu_cpuid_t *regs);
@@ -79,6 +79,26 @@ INT_NOERRCODE 31
   %assign i i+1
 %endrep
 
+;-------------------------------------------------------------------------------
+; IRQ Handlers
+;-------------------------------------------------------------------------------
+
+; Macro for IRQs using the fast path
+; Saves rdi and passes the vector in it
+%macro INT_IRQ 1
+    _cpu_int_irq%1:
+        push rdi
+        mov edi, %1
+        jmp _cpu_int_irq_common
+%endmacro
+
+; IRQs (no exceptions)
+%assign i 32
+%rep 224
+  INT_IRQ i
+  %assign i i+1
+%endrep
+
 ;-------------------------------------------------------------------------------
 ; Common Handler
 ;-------------------------------------------------------------------------------
@@ -88,6 +108,10 @@ INT_NOERRCODE 31
 
 ; Common interrupt handler
 _cpu_int_handler_common:
+    test qword [rsp + 24], 3    ; Coming from user mode (CS RPL)?
+    jz .kernel_entry
+    swapgs                  ; Switch to the kernel's GS base (per-CPU data)
+.kernel_entry:
     push rbp
     push rdi
     push rsi
@@ -109,11 +133,11 @@ _cpu_int_handler_common:
     push rax                ; save the data segment descriptor
 
     mov ax, 0x10            ; load the kernel data segment descriptor
-    mov ds, ax
+    mov ds, ax              ; (GS is kept, as loading it clears its base)
     mov es, ax
     mov fs, ax
-    mov gs, ax
     
+    cld                     ; The ABI requires a clear direction flag
     mov rdi, rsp            ; Pass stack pointer as parameter
 
     call _cpu_int_handler
@@ -124,7 +148,6 @@ _cpu_int_handler_common:
     mov ds, bx
     mov es, bx
     mov fs, bx
-    mov gs, bx
 
     pop r15
     pop r14
@@ -143,8 +166,71 @@ _cpu_int_handler_common:
     pop rbp
     
     add rsp, 16             ; Cleans up the pushed error code and pushed ISR numbers
+    
+    test qword [rsp + 8], 3 ; Returning to user mode?
+    jz .kernel_exit
+    swapgs                  ; Restore the user's GS base
+.kernel_exit:
     iretq                   ; pops 5 things at once: CS, EIP, EFLAGS, SS, and ESP
     
+;-------------------------------------------------------------------------------
+; Fast IRQ Handler
+;-------------------------------------------------------------------------------
+
+; IRQ handler table in C code
+[EXTERN _cpu_int_irq_handlers]
+
+; Runs deferred work on IRQ exit
+[EXTERN cpu_defer_run]
+
+; Switches threads on IRQ exit at the end of a time slice
+[EXTERN thread_preempt]
+
+; Common fast path IRQ handler
+; Only saves the registers a C function may clobber and keeps the segment
+; registers, which are ignored in 64 bit mode. rdi (vector) has been saved by
+; the stub. The CPU aligns the stack to 16 bytes before pushing its 40 byte
+; frame, so the 9 saved registers leave the stack aligned for the call.
+_cpu_int_irq_common:
+    test qword [rsp + 16], 3    ; Coming from user mode (CS RPL)?
+    jz .kernel_entry
+    swapgs                  ; Switch to the kernel's GS base (per-CPU data)
+.kernel_entry:
+    push rax
+    push rcx
+    push rdx
+    push rsi
+    push r8
+    push r9
+    push r10
+    push r11
+    
+    cld                     ; The ABI requires a clear direction flag
+    mov rax, _cpu_int_irq_handlers
+    call [rax + rdi * 8]    ; Call handler with the vector as parameter
+    
+    mov rax, cpu_defer_run
+    call rax                ; Run deferred work (with interrupts enabled)
+    
+    mov rax, thread_preempt
+    call rax                ; Preempt the interrupted thread, if due
+    
+    pop r11
+    pop r10
+    pop r9
+    pop r8
+    pop rsi
+    pop rdx
+    pop rcx
+    pop rax
+    pop rdi
+    
+    test qword [rsp + 8], 3 ; Returning to user mode?
+    jz .kernel_exit
+    swapgs                  ; Restore the user's GS base
+.kernel_exit:
+    iretq
+    
 ;-------------------------------------------------------------------------------
 ; Handler Addresses
 ;-------------------------------------------------------------------------------
@@ -158,3 +244,15 @@ _cpu_int_handlers:
     dq _cpu_int_handler %+ i
     %assign i i+1
   %endrep
+
+; Array with all fast path IRQ handlers (null for exceptions)
+[GLOBAL _cpu_int_irq_stubs]
+_cpu_int_irq_stubs:
+  %rep 32
+    dq 0
+  %endrep
+  %assign i 32
+  %rep 224
+    dq _cpu_int_irq %+ i
+    %assign i i+1
+  %endrep
@@ -22,6 +22,8 @@ TRAMPOLINE_GDT32_OFFSET         equ         0x1C14
 TRAMPOLINE_GDT32_PTR_OFFSET     equ         0x1C0E
 TRAMPOLINE_ENTRY_POINT_OFFSET   equ         0x1C06
 TRAMPOLINE_GDT64_PTR_OFFSET     equ         0x1C00
+TRAMPOLINE_STACKS_OFFSET        equ         0x1C30
+TRAMPOLINE_STACK_NEXT_OFFSET    equ         0x1C38
 
 TRAMPOLINE_PROTECTED_OFFSET     equ         0x1400
 TRAMPOLINE_LONG_OFFSET          equ         0x1800
@@ -89,6 +91,19 @@ trampoline_protected:
 [BITS 64]
 align 0x400
 trampoline_long:
+    ; Take the next free stack (APs may start at the same time)
+    mov rax, 1
+    mov rdi, TRAMPOLINE_STACK_NEXT_OFFSET
+    lock xadd [rdi], rax
+    
+    mov rdi, TRAMPOLINE_STACKS_OFFSET
+    mov rdi, [rdi]
+    mov rsp, [rdi + rax * 8]
+    
+    ; Null return address, as if called
+    push 0
+    
+    ; Jump to entry point
     mov rdi, TRAMPOLINE_ENTRY_POINT_OFFSET
     mov rax, [rdi]
     jmp rax
@@ -150,3 +165,14 @@ trampoline_gdt32:
     ;db 0x92                         ; Access
     ;db 0xCF                         ; Limit High + Flags
     ;db 0x0                          ; Base high
+
+; Address of the table of the APs' stack tops, filled in by kernel
+; Offset: 48
+align 0x10
+trampoline_stacks:
+    dq 0x0
+    
+; Index of the next stack to take
+; Offset: 56
+trampoline_stack_next:
+    dq 0x0
@@ -16,50 +16,44 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
  
-#pragma once
-#include <api/type.h>
-#include <api/process/stack.h>
 
-// TODO: Complete this somewhen
+#include <api/types.h>
+#include <amd64/cpu.h>
 
 //----------------------------------------------------------------------------//
 // Internal
 //----------------------------------------------------------------------------//
 
-static void _stack_copy_switch(uintptr_t address, uintptr_t size, uintptr_t initial_addr, bool switch_stack)
+/**
+ * Executes the <tt>CPUID</tt> instruction without range checks.
+ *
+ * @param leaf The leaf to query.
+ * @param subleaf The subleaf to query.
+ * @param regs Structure to store the resulting registers in.
+ */
+static void _cpu_cpuid_raw(uint32_t leaf, uint32_t subleaf, cpu_cpuid_t *regs)
 {
-    // Get stack and base pointer
-    uintptr_t old_rsp;
-    asm volatile("mov %%rsp, %0" : "=r" (old_rsp));
-    
-    uintptr_t old_rbp;
-    asm volatile("mov %%rbp, %0" : "=r" (old_rbp));
-    
-    // Calculate offset to add to RSP/RBP
-    uintptr_t offset = address - initial_addr;
-    
-    // New pointers
-    uintptr_t new_rsp = old_rsp + offset;
-    uintptr_t new_rbp = old_rbp + offset;
-    
-    // Copy the stack
-    memcpy((void *) new_rsp, (void *) old_rsp, initial_addr - old_rsp);
-    
-    // Switch the stack?
-    if (
+    asm volatile (
+        "cpuid"
+        : "=a" (regs->eax), "=b" (regs->ebx), "=c" (regs->ecx), "=d" (regs->edx)
+        : "a" (leaf), "c" (subleaf));
 }
 
 //----------------------------------------------------------------------------//
-// Copying
+// CPUID
 //----------------------------------------------------------------------------//
 
-void stack_copy_switch(uintptr_t address, uintptr_t size, uintptr_t initial_addr);
+void cpu_cpuid(uint32_t leaf, uint32_t subleaf, cpu_cpuid_t *regs)
 {
-    // Copy the stack
-    stack_copy(address, size, initial_addr);
-}
-
-void stack_copy()
-{
-
+    // Get the maximum leaf of the requested range (basic or extended)
+    cpu_cpuid_t max;
+    _cpu_cpuid_raw(leaf & 0x80000000, 0, &max);
+    
+    // Leaf not supported?
+    if (leaf > max.eax) {
+        regs->eax = regs->ebx = regs->ecx = regs->edx = 0;
+        return;
+    }
+    
+    _cpu_cpuid_raw(leaf, subleaf, regs);
 }
@@ -26,5 +26,31 @@ void cpu_set_cr3(uintptr_t cr3)
 
 uintptr_t cpu_get_cr3()
 {
-    asm volatile ("mov %cr3, %rax");
+    uintptr_t cr3;
+    asm volatile ("mov %%cr3, %0" : "=r" (cr3));
+    return cr3;
+}
+
+void cpu_set_cr0(uintptr_t cr0)
+{
+    asm volatile ("mov %0, %%cr0" :: "r" (cr0));
+}
+
+uintptr_t cpu_get_cr0()
+{
+    uintptr_t cr0;
+    asm volatile ("mov %%cr0, %0" : "=r" (cr0));
+    return cr0;
+}
+
+void cpu_set_cr4(uintptr_t cr4)
+{
+    asm volatile ("mov %0, %%cr4" :: "r" (cr4));
+}
+
+uintptr_t cpu_get_cr4()
+{
+    uintptr_t cr4;
+    asm volatile ("mov %%cr4, %0" : "=r" (cr4));
+    return cr4;
 }
@@ -0,0 +1,204 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+
+#include <api/types.h>
+#include <api/string.h>
+#include <api/cpu.h>
+
+#include <api/cpu/int.h>
+#include <api/cpu/defer.h>
+
+#include <api/memory/heap.h>
+
+#include <amd64/cpu.h>
+#include <amd64/cpu/int.h>
+#include <amd64/cpu/ipi.h>
+#include <amd64/cpu/lapic.h>
+#include <amd64/cpu/defer.h>
+
+//----------------------------------------------------------------------------//
+// Deferred Work - Structures
+//----------------------------------------------------------------------------//
+
+/**
+ * An entry of a deferred work queue.
+ */
+typedef struct cpu_defer_entry_t
+{
+    defer_handler_t handler;
+    void *arg;
+} cpu_defer_entry_t;
+
+/**
+ * A CPU's deferred work queue.
+ *
+ * Only accessed by its CPU with interrupts disabled, so no lock is required.
+ */
+typedef struct cpu_defer_queue_t
+{
+    /**
+     * Ring buffer of queued work.
+     */
+    cpu_defer_entry_t entries[DEFER_QUEUE_SIZE];
+    
+    /**
+     * Index of the next entry to run and the next free entry.
+     */
+    size_t head, tail;
+    
+    /**
+     * Whether deferred work is currently running on the CPU.
+     */
+    bool running;
+    
+} cpu_defer_queue_t;
+
+//----------------------------------------------------------------------------//
+// Deferred Work - Variables
+//----------------------------------------------------------------------------//
+
+/**
+ * Queues per CPU, indexed by the CPU's logical number.
+ */
+static cpu_defer_queue_t *cpu_defer_queues[MAX_CPUS];
+
+/**
+ * Whether the queues have been allocated.
+ */
+static bool cpu_defer_ready = false;
+
+//----------------------------------------------------------------------------//
+// Deferred Work - Internal
+//----------------------------------------------------------------------------//
+
+/**
+ * Returns the current CPU's queue.
+ *
+ * @return The queue or a null-pointer, if not yet allocated.
+ */
+static cpu_defer_queue_t *_cpu_defer_queue(void)
+{
+    if (!cpu_defer_ready)
+        return 0;
+        
+    return cpu_defer_queues[cpu_current_index()];
+}
+
+/**
+ * IRQ handler for the self-IPI that continues remaining deferred work.
+ *
+ * The work itself is run on IRQ exit.
+ *
+ * @param vector The interrupt vector.
+ */
+static void _cpu_defer_irq(interrupt_vector_t vector)
+{
+    cpu_lapic_eoi();
+}
+
+//----------------------------------------------------------------------------//
+// Deferred Work
+//----------------------------------------------------------------------------//
+
+void cpu_defer_init(void)
+{
+    size_t i;
+    
+    for (i = 0; i < cpu_count(); ++i) {
+        cpu_defer_queue_t *queue = malloc(sizeof(cpu_defer_queue_t));
+        memset(queue, 0, sizeof(cpu_defer_queue_t));
+        cpu_defer_queues[i] = queue;
+    }
+    
+    // Register handler for continuation IPI
+    cpu_int_register_irq(INT_VECTOR_DEFER, &_cpu_defer_irq);
+    
+    cpu_defer_ready = true;
+}
+
+bool cpu_defer(defer_handler_t handler, void *arg)
+{
+    // Disable interrupts while accessing the queue
+    bool interruptable = cpu_is_interruptable();
+    cpu_set_interruptable(false);
+    
+    cpu_defer_queue_t *queue = _cpu_defer_queue();
+    bool queued = false;
+    
+    // Space left?
+    if (0 != queue && queue->tail - queue->head < DEFER_QUEUE_SIZE) {
+        cpu_defer_entry_t *entry =
+            &queue->entries[queue->tail % DEFER_QUEUE_SIZE];
+        entry->handler = handler;
+        entry->arg = arg;
+        
+        ++queue->tail;
+        queued = true;
+    }
+    
+    // Restore interrupt state
+    if (interruptable)
+        cpu_set_interruptable(true);
+        
+    return queued;
+}
+
+void cpu_defer_run(void)
+{
+    cpu_defer_queue_t *queue = _cpu_defer_queue();
+    
+    // Nothing to do or interrupted deferred work?
+    if (0 == queue || queue->running || queue->head == queue->tail)
+        return;
+        
+    queue->running = true;
+    
+    // Run work within budget
+    size_t budget;
+    
+    for (budget = DEFER_BUDGET; budget > 0 && queue->head != queue->tail; --budget) {
+        // Dequeue
+        cpu_defer_entry_t entry = queue->entries[queue->head % DEFER_QUEUE_SIZE];
+        ++queue->head;
+        
+        // Run with interrupts enabled
+        cpu_set_interruptable(true);
+        entry.handler(entry.arg);
+        cpu_set_interruptable(false);
+    }
+    
+    queue->running = false;
+    
+    // Continue remaining work after pending interrupts have been handled
+    if (queue->head != queue->tail)
+        cpu_ipi(
+            INT_VECTOR_DEFER,           // Vector
+            0,                          // Destination
+            IPI_DEST_SELF,              // Destination shorthand
+            IPI_MODE_PHYSICAL,          // Destination mode
+            IPI_DELIVERY_FIXED,         // Delivery mode
+            IPI_LEVEL_ASSERT,           // Level
+            cpu_current());             // Current CPU
+}
+
+bool cpu_defer_running(void)
+{
+    cpu_defer_queue_t *queue = _cpu_defer_queue();
+    return (0 != queue && queue->running);
+}
@@ -0,0 +1,65 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+
+#pragma once
+#include <api/types.h>
+#include <api/cpu/defer.h>
+
+//----------------------------------------------------------------------------//
+// Deferred Work - Constants
+//----------------------------------------------------------------------------//
+
+/**
+ * Number of entries in each CPU's deferred work queue (power of two).
+ */
+#define DEFER_QUEUE_SIZE            64
+
+/**
+ * Maximum number of handlers run on a single IRQ exit. Remaining work is
+ * continued after a self-IPI, so other interrupts are not starved.
+ */
+#define DEFER_BUDGET                16
+
+//----------------------------------------------------------------------------//
+// Deferred Work
+//----------------------------------------------------------------------------//
+
+/**
+ * Allocates the deferred work queues for all CPUs.
+ *
+ * Only to be called once on the BSP after all CPUs have been added.
+ */
+void cpu_defer_init(void);
+
+/**
+ * Runs pending deferred work of the current CPU with interrupts enabled.
+ *
+ * Called on IRQ exit with interrupts disabled, after the IRQ has been
+ * acknowledged; returns with interrupts disabled. Does nothing when called
+ * from an IRQ that interrupted deferred work.
+ */
+void cpu_defer_run(void);
+
+/**
+ * Checks whether deferred work is running on the current CPU, i.e. whether
+ * the current context interrupted it.
+ *
+ * @return Whether deferred work is running.
+ */
+bool cpu_defer_running(void);
@@ -0,0 +1,195 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+
+#include <api/types.h>
+#include <api/cpu.h>
+#include <api/debug/console.h>
+
+#include <amd64/cpu.h>
+#include <amd64/cpu/features.h>
+
+//----------------------------------------------------------------------------//
+// Internal - Types
+//----------------------------------------------------------------------------//
+
+#define CPUID_REG_EAX               0
+#define CPUID_REG_EBX               1
+#define CPUID_REG_ECX               2
+#define CPUID_REG_EDX               3
+
+/**
+ * Location of a feature flag in the <tt>CPUID</tt> output.
+ */
+typedef struct cpu_feature_desc_t
+{
+    uint32_t leaf;
+    uint8_t subleaf;
+    uint8_t reg;
+    uint8_t bit;
+} cpu_feature_desc_t;
+
+//----------------------------------------------------------------------------//
+// Variables
+//----------------------------------------------------------------------------//
+
+/**
+ * Feature flags, indexed by feature identifier.
+ */
+static const cpu_feature_desc_t cpu_feature_descs[CPU_FEATURE_COUNT] = {
+    { 0x00000001, 0, CPUID_REG_EDX,  4 },   // TSC
+    { 0x00000001, 0, CPUID_REG_EDX,  9 },   // APIC
+    { 0x00000001, 0, CPUID_REG_EDX, 24 },   // FXSR
+    { 0x00000001, 0, CPUID_REG_EDX, 26 },   // SSE2
+    { 0x00000001, 0, CPUID_REG_ECX,  3 },   // MONITOR
+    { 0x00000001, 0, CPUID_REG_ECX, 17 },   // PCID
+    { 0x00000001, 0, CPUID_REG_ECX, 20 },   // SSE4_2
+    { 0x00000001, 0, CPUID_REG_ECX, 21 },   // X2APIC
+    { 0x00000001, 0, CPUID_REG_ECX, 24 },   // TSC_DEADLINE
+    { 0x00000001, 0, CPUID_REG_ECX, 26 },   // XSAVE
+    { 0x00000001, 0, CPUID_REG_ECX, 28 },   // AVX
+    { 0x00000001, 0, CPUID_REG_ECX, 31 },   // HYPERVISOR
+    { 0x00000006, 0, CPUID_REG_EAX,  2 },   // ARAT
+    { 0x00000007, 0, CPUID_REG_EBX,  0 },   // FSGSBASE
+    { 0x00000007, 0, CPUID_REG_EBX,  7 },   // SMEP
+    { 0x00000007, 0, CPUID_REG_EBX,  9 },   // ERMS
+    { 0x00000007, 0, CPUID_REG_EBX, 10 },   // INVPCID
+    { 0x00000007, 0, CPUID_REG_EDX,  4 },   // FSRM
+    { 0x0000000D, 1, CPUID_REG_EAX,  0 },   // XSAVEOPT
+    { 0x0000000D, 1, CPUID_REG_EAX,  3 },   // XSAVES
+    { 0x80000001, 0, CPUID_REG_EDX, 20 },   // NX
+    { 0x80000001, 0, CPUID_REG_EDX, 26 },   // PAGE_1GB
+    { 0x80000001, 0, CPUID_REG_EDX, 27 },   // RDTSCP
+    { 0x80000007, 0, CPUID_REG_EDX,  8 },   // INVARIANT_TSC
+};
+
+/**
+ * Features of the system (as detected on the BSP).
+ */
+static uint64_t cpu_features_system = 0;
+
+/**
+ * Features the selected alternatives rely on.
+ */
+static uint64_t cpu_features_required = 0;
+
+/**
+ * Bounds of the alternatives section (see linker script).
+ */
+extern cpu_alternative_t cpu_alternatives_begin;
+extern cpu_alternative_t cpu_alternatives_end;
+
+//----------------------------------------------------------------------------//
+// Features
+//----------------------------------------------------------------------------//
+
+void cpu_features_init(void)
+{
+    cpu_features_system = cpu_features_detect();
+}
+
+uint64_t cpu_features_detect(void)
+{
+    uint64_t features = 0;
+    cpu_cpuid_t regs;
+    uint32_t leaf = (uint32_t) -1;
+    uint8_t subleaf = 0;
+    size_t i;
+    
+    for (i = 0; i < CPU_FEATURE_COUNT; ++i) {
+        const cpu_feature_desc_t *desc = &cpu_feature_descs[i];
+        
+        // Query leaf (the table is sorted by leaf)
+        if (desc->leaf != leaf || desc->subleaf != subleaf) {
+            leaf = desc->leaf;
+            subleaf = desc->subleaf;
+            cpu_cpuid(leaf, subleaf, &regs);
+        }
+        
+        // Get register
+        uint32_t value;
+        
+        switch (desc->reg) {
+            case CPUID_REG_EAX: value = regs.eax; break;
+            case CPUID_REG_EBX: value = regs.ebx; break;
+            case CPUID_REG_ECX: value = regs.ecx; break;
+            default:            value = regs.edx; break;
+        }
+        
+        // Set feature bit
+        if (value & (1U << desc->bit))
+            features |= CPU_FEATURE_BIT(i);
+    }
+    
+    return features;
+}
+
+bool cpu_feature_present(uint32_t feature)
+{
+    return 0 != (cpu_features_system & CPU_FEATURE_BIT(feature));
+}
+
+bool cpu_features_check(cpu_t *cpu)
+{
+    // All required features present?
+    uint64_t missing = cpu_features_required & ~cpu->features;
+    
+    if (0 == missing)
+        return true;
+        
+    console_print("[CPU ] Processor ");
+    console_print_hex(cpu->id);
+    console_print(" lacks features required by the BSP: ");
+    console_print_hex(missing);
+    console_print("\n");
+    
+    return false;
+}
+
+//----------------------------------------------------------------------------//
+// Alternatives
+//----------------------------------------------------------------------------//
+
+void cpu_alternatives_apply(void)
+{
+    cpu_alternative_t *alt;
+    cpu_alternative_t *other;
+    
+    for (alt = &cpu_alternatives_begin; alt < &cpu_alternatives_end; ++alt) {
+        // Feature present?
+        if (!cpu_feature_present(alt->feature))
+            continue;
+            
+        // Present alternative with higher priority for the same target?
+        bool preferred = true;
+        
+        for (other = &cpu_alternatives_begin; other < &cpu_alternatives_end; ++other)
+            if (other->target == alt->target &&
+                other->priority > alt->priority &&
+                cpu_feature_present(other->feature)) {
+                preferred = false;
+                break;
+            }
+                
+        // Select implementation
+        if (preferred) {
+            *alt->target = alt->impl;
+            cpu_features_required |= CPU_FEATURE_BIT(alt->feature);
+        }
+    }
+}
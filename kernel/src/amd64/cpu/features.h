@@ -0,0 +1,169 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+
+#pragma once
+#include <api/types.h>
+#include <api/cpu.h>
+
+//----------------------------------------------------------------------------//
+// Features - Identifiers
+//----------------------------------------------------------------------------//
+
+// Leaf 0x01
+#define CPU_FEATURE_TSC             0
+#define CPU_FEATURE_APIC            1
+#define CPU_FEATURE_FXSR            2
+#define CPU_FEATURE_SSE2            3
+#define CPU_FEATURE_MONITOR         4
+#define CPU_FEATURE_PCID            5
+#define CPU_FEATURE_SSE4_2          6
+#define CPU_FEATURE_X2APIC          7
+#define CPU_FEATURE_TSC_DEADLINE    8
+#define CPU_FEATURE_XSAVE           9
+#define CPU_FEATURE_AVX             10
+#define CPU_FEATURE_HYPERVISOR      11
+
+// Leaf 0x06
+#define CPU_FEATURE_ARAT            12
+
+// Leaf 0x07
+#define CPU_FEATURE_FSGSBASE        13
+#define CPU_FEATURE_SMEP            14
+#define CPU_FEATURE_ERMS            15
+#define CPU_FEATURE_INVPCID         16
+#define CPU_FEATURE_FSRM            17
+
+// Leaf 0x0D, subleaf 1
+#define CPU_FEATURE_XSAVEOPT        18
+#define CPU_FEATURE_XSAVES          19
+
+// Leaf 0x80000001
+#define CPU_FEATURE_NX              20
+#define CPU_FEATURE_PAGE_1GB        21
+#define CPU_FEATURE_RDTSCP          22
+
+// Leaf 0x80000007
+#define CPU_FEATURE_INVARIANT_TSC   23
+
+#define CPU_FEATURE_COUNT           24
+
+//----------------------------------------------------------------------------//
+// Features - Macros
+//----------------------------------------------------------------------------//
+
+/**
+ * Bit of the given feature in a feature bitmap.
+ */
+#define CPU_FEATURE_BIT(feature)    ((uint64_t) 1 << (feature))
+
+/**
+ * Checks whether the given CPU supports the given feature.
+ */
+#define CPU_HAS_FEATURE(cpu, feature) \
+    (0 != ((cpu)->features & CPU_FEATURE_BIT(feature)))
+
+//----------------------------------------------------------------------------//
+// Features
+//----------------------------------------------------------------------------//
+
+/**
+ * Detects the features of the BSP, which are used as the system's features
+ * until the APs have been started.
+ *
+ * Must be called as early as possible during boot and before
+ * <tt>cpu_alternatives_apply</tt>.
+ */
+void cpu_features_init(void);
+
+/**
+ * Detects the features of the current processor.
+ *
+ * @return Bitmap of the processor's features.
+ */
+uint64_t cpu_features_detect(void);
+
+/**
+ * Checks whether the given feature is supported by the system.
+ *
+ * @param feature The feature to check.
+ * @return Whether the feature is supported.
+ */
+bool cpu_feature_present(uint32_t feature);
+
+/**
+ * Checks whether the given CPU supports all features the selected alternatives
+ * rely on and prints a warning otherwise.
+ *
+ * @param cpu The CPU to check.
+ * @return Whether all required features are supported.
+ */
+bool cpu_features_check(cpu_t *cpu);
+
+//----------------------------------------------------------------------------//
+// Alternatives
+//----------------------------------------------------------------------------//
+
+/**
+ * An alternative implementation for a function pointer, selected at boot time
+ * if the feature it depends on is present.
+ */
+typedef struct cpu_alternative_t
+{
+    /**
+     * The feature the implementation depends on.
+     */
+    uint32_t feature;
+    
+    /**
+     * Priority of the implementation; the present alternative with the highest
+     * priority is selected.
+     */
+    uint32_t priority;
+    
+    /**
+     * The function pointer to set.
+     */
+    void **target;
+    
+    /**
+     * The implementation to set the function pointer to.
+     */
+    void *impl;
+    
+} cpu_alternative_t;
+
+/**
+ * Registers <tt>impl</tt> as an alternative for the function pointer
+ * <tt>target</tt> if <tt>feature</tt> is present.
+ *
+ * The function pointer's initializer is the fallback, that is used if none of
+ * its alternatives are present.
+ */
+#define CPU_ALTERNATIVE(target, feature, priority, impl) \
+    static cpu_alternative_t _cpu_alternative_##target##_##impl \
+    __attribute__((section(".alternatives"), used, aligned(8))) = \
+        { (feature), (priority), (void **) &(target), (void *) &(impl) }
+
+/**
+ * Selects the implementations for all function pointers with registered
+ * alternatives.
+ *
+ * Only to be called once on the BSP after <tt>cpu_features_init</tt>.
+ */
+void cpu_alternatives_apply(void);
@@ -0,0 +1,284 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+
+#include <api/types.h>
+#include <api/string.h>
+#include <api/cpu.h>
+
+#include <api/cpu/int.h>
+
+#include <api/memory/heap.h>
+
+#include <api/multitasking/thread.h>
+
+#include <api/debug/console.h>
+
+#include <amd64/cpu.h>
+#include <amd64/cpu/features.h>
+#include <amd64/cpu/fpu.h>
+#include <amd64/cpu/percpu.h>
+
+//----------------------------------------------------------------------------//
+// FPU - Variables
+//----------------------------------------------------------------------------//
+
+/**
+ * The thread whose extended state was last loaded on the current CPU, and
+ * whether the first use trap is armed.
+ */
+PERCPU thread_t *cpu_fpu_owner = 0;
+PERCPU bool cpu_fpu_trap = false;
+
+/**
+ * State components enabled in <tt>XCR0</tt>.
+ */
+static uint64_t _cpu_fpu_xcr0 = 0;
+
+/**
+ * Size of the extended state and its initial value, which new threads start
+ * with.
+ */
+static size_t _cpu_fpu_size = 512;
+static void *_cpu_fpu_initial = 0;
+
+//----------------------------------------------------------------------------//
+// FPU - Internal - Save and Restore
+//----------------------------------------------------------------------------//
+
+// FXSAVE is the fallback, always present in long mode. XSAVEOPT skips
+// components in their initial state and those unmodified since the last
+// restore; XSAVES additionally uses the compacted format.
+
+static void _cpu_fpu_fxsave(void *state)
+{
+    asm volatile ("fxsave64 (%0)" :: "r" (state) : "memory");
+}
+
+static void _cpu_fpu_fxrstor(void *state)
+{
+    asm volatile ("fxrstor64 (%0)" :: "r" (state) : "memory");
+}
+
+static void _cpu_fpu_xsave(void *state)
+{
+    asm volatile ("xsave64 (%0)" :: "r" (state), "a" (-1), "d" (-1) : "memory");
+}
+
+static void _cpu_fpu_xsaveopt(void *state)
+{
+    asm volatile ("xsaveopt64 (%0)" :: "r" (state), "a" (-1), "d" (-1) : "memory");
+}
+
+static void _cpu_fpu_xrstor(void *state)
+{
+    asm volatile ("xrstor64 (%0)" :: "r" (state), "a" (-1), "d" (-1) : "memory");
+}
+
+static void _cpu_fpu_xsaves(void *state)
+{
+    asm volatile ("xsaves64 (%0)" :: "r" (state), "a" (-1), "d" (-1) : "memory");
+}
+
+static void _cpu_fpu_xrstors(void *state)
+{
+    asm volatile ("xrstors64 (%0)" :: "r" (state), "a" (-1), "d" (-1) : "memory");
+}
+
+/**
+ * Selected save and restore implementations (using the same format).
+ */
+static void (*_cpu_fpu_save)(void *) = &_cpu_fpu_fxsave;
+static void (*_cpu_fpu_restore)(void *) = &_cpu_fpu_fxrstor;
+
+CPU_ALTERNATIVE(_cpu_fpu_save, CPU_FEATURE_XSAVE, 1, _cpu_fpu_xsave);
+CPU_ALTERNATIVE(_cpu_fpu_save, CPU_FEATURE_XSAVEOPT, 2, _cpu_fpu_xsaveopt);
+CPU_ALTERNATIVE(_cpu_fpu_save, CPU_FEATURE_XSAVES, 3, _cpu_fpu_xsaves);
+CPU_ALTERNATIVE(_cpu_fpu_restore, CPU_FEATURE_XSAVE, 1, _cpu_fpu_xrstor);
+CPU_ALTERNATIVE(_cpu_fpu_restore, CPU_FEATURE_XSAVES, 3, _cpu_fpu_xrstors);
+
+//----------------------------------------------------------------------------//
+// FPU - Internal
+//----------------------------------------------------------------------------//
+
+/**
+ * Arms or disarms the first use trap by setting or clearing <tt>CR0.TS</tt>.
+ *
+ * @param trap Whether to arm the trap.
+ */
+static void _cpu_fpu_set_trap(bool trap)
+{
+    if (trap == percpu_read(cpu_fpu_trap))
+        return;
+        
+    if (trap)
+        cpu_set_cr0(cpu_get_cr0() | FPU_CR0_TS);
+    else
+        asm volatile ("clts");
+        
+    percpu_write(cpu_fpu_trap, trap);
+}
+
+/**
+ * Returns the aligned extended state buffer of the given thread.
+ *
+ * @param thread The thread.
+ * @return The buffer.
+ */
+static void *_cpu_fpu_state(thread_t *thread)
+{
+    return (void *) mem_align((uintptr_t) thread->fpu, FPU_ALIGN);
+}
+
+/**
+ * Handler for the device-not-available trap, raised by the first FPU, SSE or
+ * AVX instruction after a switch; loads the current thread's state, unless
+ * the registers still hold it.
+ *
+ * @param vector The vector of the trap.
+ * @param ctx The interrupted context.
+ * @return The context to return to.
+ */
+static void *_cpu_fpu_trap(interrupt_vector_t vector, void *ctx)
+{
+    _cpu_fpu_set_trap(false);
+    
+    thread_t *current = thread_current();
+    uint32_t cpu = (uint32_t) cpu_current_index();
+    
+    // Before threads are set up, the state is not switched
+    if (0 == current)
+        return ctx;
+        
+    // Registers still hold the thread's state?
+    if (current == percpu_read(cpu_fpu_owner) && cpu == current->fpu_cpu)
+        return ctx;
+        
+    // First use: start with the initial state
+    if (0 == (current->flags & THREAD_FLAG_FPU)) {
+        if (0 == current->fpu)
+            current->fpu = malloc(_cpu_fpu_size + FPU_ALIGN);
+            
+        memcpy(_cpu_fpu_state(current), _cpu_fpu_initial, _cpu_fpu_size);
+        __sync_fetch_and_or(&current->flags, THREAD_FLAG_FPU);
+    }
+    
+    // Load
+    _cpu_fpu_restore(_cpu_fpu_state(current));
+    current->fpu_cpu = cpu;
+    percpu_write(cpu_fpu_owner, current);
+    
+    return ctx;
+}
+
+//----------------------------------------------------------------------------//
+// FPU
+//----------------------------------------------------------------------------//
+
+void cpu_fpu_init(void)
+{
+    // Select state components
+    if (cpu_feature_present(CPU_FEATURE_XSAVE)) {
+        cpu_cpuid_t regs;
+        cpu_cpuid(0x0D, 0, &regs);
+        
+        uint64_t supported = ((uint64_t) regs.edx << 32) | regs.eax;
+        _cpu_fpu_xcr0 = supported & FPU_XCR0_BASE;
+        
+        if (FPU_XCR0_AVX512 == (supported & FPU_XCR0_AVX512))
+            _cpu_fpu_xcr0 |= FPU_XCR0_AVX512;
+    }
+    
+    // Enable on the BSP
+    cpu_fpu_load();
+    
+    // Size of the enabled components (compacted for XSAVES)
+    cpu_cpuid_t regs;
+    
+    if (cpu_feature_present(CPU_FEATURE_XSAVES)) {
+        cpu_cpuid(0x0D, 1, &regs);
+        _cpu_fpu_size = regs.ebx;
+    } else if (cpu_feature_present(CPU_FEATURE_XSAVE)) {
+        cpu_cpuid(0x0D, 0, &regs);
+        _cpu_fpu_size = regs.ebx;
+    }
+    
+    // Initial state: default control words, all components in their initial
+    // configuration (XSTATE_BV of zero)
+    _cpu_fpu_initial = malloc(_cpu_fpu_size + FPU_ALIGN);
+    _cpu_fpu_initial = (void *) mem_align((uintptr_t) _cpu_fpu_initial, FPU_ALIGN);
+    memset(_cpu_fpu_initial, 0, _cpu_fpu_size);
+    
+    *((uint16_t *) _cpu_fpu_initial) = 0x037F;                  // FCW
+    *((uint32_t *) ((uintptr_t) _cpu_fpu_initial + 24)) = 0x1F80; // MXCSR
+    
+    if (cpu_feature_present(CPU_FEATURE_XSAVES))                // XCOMP_BV
+        *((uint64_t *) ((uintptr_t) _cpu_fpu_initial + 520)) =
+            (1ULL << 63) | _cpu_fpu_xcr0;
+            
+    // Load state on first use
+    cpu_int_register(FPU_VECTOR_NM, &_cpu_fpu_trap);
+    
+    console_debug("[CPU ] Extended state: ");
+    console_debug_dec((intptr_t) _cpu_fpu_size);
+    console_debug(" bytes\n");
+}
+
+void cpu_fpu_load(void)
+{
+    // No emulation, trap on first use after switches
+    cpu_set_cr0((cpu_get_cr0() & ~FPU_CR0_EM) | FPU_CR0_MP | FPU_CR0_TS);
+    percpu_write(cpu_fpu_trap, true);
+    
+    // FXSAVE, SSE and SIMD exceptions
+    uintptr_t cr4 = cpu_get_cr4() | FPU_CR4_OSFXSR | FPU_CR4_OSXMMEXCPT;
+    
+    // XSAVE with the selected components, no supervisor components
+    if (0 != _cpu_fpu_xcr0) {
+        cpu_set_cr4(cr4 | FPU_CR4_OSXSAVE);
+        
+        asm volatile ("xsetbv" :: "c" (0),
+            "a" ((uint32_t) _cpu_fpu_xcr0),
+            "d" ((uint32_t) (_cpu_fpu_xcr0 >> 32)));
+            
+        if (cpu_feature_present(CPU_FEATURE_XSAVES))
+            cpu_msr_write(FPU_XSS_MSR, 0);
+    } else
+        cpu_set_cr4(cr4);
+}
+
+size_t cpu_fpu_size(void)
+{
+    return _cpu_fpu_size;
+}
+
+void cpu_fpu_switch(thread_t *prev)
+{
+    // FPU not used since the switch to the thread?
+    if (percpu_read(cpu_fpu_trap))
+        return;
+        
+    // Save, so the thread may resume on any CPU (cheap with XSAVEOPT/XSAVES
+    // for unmodified components); not needed anymore once exited
+    if ((prev->flags & THREAD_FLAG_FPU) && THREAD_STATE_DEAD != prev->state)
+        _cpu_fpu_save(_cpu_fpu_state(prev));
+    else
+        percpu_write(cpu_fpu_owner, 0);
+        
+    _cpu_fpu_set_trap(true);
+}
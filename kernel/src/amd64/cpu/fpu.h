@@ -0,0 +1,96 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+#pragma once
+#include <api/types.h>
+#include <api/multitasking/thread.h>
+
+//----------------------------------------------------------------------------//
+// FPU - Constants
+//----------------------------------------------------------------------------//
+
+#define FPU_CR0_MP                  (1 << 1)    // Monitor coprocessor
+#define FPU_CR0_EM                  (1 << 2)    // Emulation
+#define FPU_CR0_TS                  (1 << 3)    // Task switched
+
+#define FPU_CR4_OSFXSR              (1 << 9)    // FXSAVE and SSE
+#define FPU_CR4_OSXMMEXCPT          (1 << 10)   // SIMD exceptions
+#define FPU_CR4_OSXSAVE             (1 << 18)   // XSAVE and XCR0
+
+/**
+ * State components enabled in <tt>XCR0</tt>, if supported: x87, SSE, AVX and
+ * the three AVX-512 components (only enabled together).
+ */
+#define FPU_XCR0_BASE               0x07
+#define FPU_XCR0_AVX512             0xE0
+
+/**
+ * MSR of the supervisor state components saved by <tt>XSAVES</tt>.
+ */
+#define FPU_XSS_MSR                 0xDA0
+
+/**
+ * Required alignment of state buffers.
+ */
+#define FPU_ALIGN                   64
+
+/**
+ * Value of a thread's <tt>fpu_cpu</tt> when its state is loaded nowhere.
+ */
+#define FPU_CPU_NONE                ((uint32_t) -1)
+
+/**
+ * Exception vector of the device-not-available trap (#NM).
+ */
+#define FPU_VECTOR_NM               7
+
+//----------------------------------------------------------------------------//
+// FPU
+//----------------------------------------------------------------------------//
+
+/**
+ * Enables the FPU, SSE and (if supported) XSAVE on the BSP, determines the
+ * size of the extended state and installs the first use trap.
+ *
+ * Only to be called once on the BSP.
+ */
+void cpu_fpu_init(void);
+
+/**
+ * Enables the FPU, SSE and XSAVE like on the BSP.
+ *
+ * To be called on each AP during startup.
+ */
+void cpu_fpu_load(void);
+
+/**
+ * Returns the size of a thread's extended state buffer.
+ *
+ * @return The size in bytes.
+ */
+size_t cpu_fpu_size(void);
+
+/**
+ * Saves the extended state of the given thread, if it used the FPU since it
+ * was switched to, and arms the first use trap for the next thread.
+ *
+ * Called with interrupts disabled before switching away from the thread.
+ *
+ * @param prev The thread to switch away from.
+ */
+void cpu_fpu_switch(thread_t *prev);
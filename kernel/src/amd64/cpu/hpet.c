@@ -0,0 +1,161 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+
+#include <api/types.h>
+
+#include <api/memory/page.h>
+
+#include <amd64/memory/page.h>
+
+#include <amd64/cpu/hpet.h>
+
+//----------------------------------------------------------------------------//
+// HPET - Constants
+//----------------------------------------------------------------------------//
+
+#define HPET_FS_PER_NS              1000000ULL
+#define HPET_FS_PER_SECOND          1000000000000000ULL
+
+//----------------------------------------------------------------------------//
+// HPET - Variables
+//----------------------------------------------------------------------------//
+
+/**
+ * Virtual address of the registers or <tt>0</tt>, if there is no HPET.
+ */
+static uintptr_t cpu_hpet_virt = 0;
+
+/**
+ * Whether the HPET has been validated and started.
+ */
+static bool cpu_hpet_ready = false;
+
+/**
+ * Mask of the main counter's valid bits.
+ */
+static uint64_t cpu_hpet_mask = 0;
+
+/**
+ * Counter period in femtoseconds.
+ */
+static uint64_t cpu_hpet_period = 0;
+
+/**
+ * Nanoseconds per counter tick (fixed point, 32 fraction bits).
+ */
+static uint64_t cpu_hpet_mult = 0;
+
+//----------------------------------------------------------------------------//
+// HPET - Internal
+//----------------------------------------------------------------------------//
+
+static uint64_t _cpu_hpet_read(size_t offset)
+{
+    return *((volatile uint64_t *) (cpu_hpet_virt + offset));
+}
+
+static void _cpu_hpet_write(size_t offset, uint64_t value)
+{
+    *((volatile uint64_t *) (cpu_hpet_virt + offset)) = value;
+}
+
+/**
+ * Converts a number of counter ticks to nanoseconds.
+ *
+ * @param counts The number of ticks.
+ * @return The time in nanoseconds.
+ */
+static uint64_t _cpu_hpet_to_ns(uint64_t counts)
+{
+    return (uint64_t) (((unsigned __int128) counts * cpu_hpet_mult) >> 32);
+}
+
+//----------------------------------------------------------------------------//
+// HPET
+//----------------------------------------------------------------------------//
+
+void cpu_hpet_set(uintptr_t addr)
+{
+    // Only the first HPET is used
+    if (0 != cpu_hpet_virt)
+        return;
+        
+    // Map registers (uncached)
+    page_map(
+        HPET_VIRTUAL_ADDR,
+        addr & ~(PAGE_SIZE - 1),
+        PG_GLOBAL | PG_PRESENT | PG_WRITABLE | PG_CACHE_DISABLE);
+    cpu_hpet_virt = HPET_VIRTUAL_ADDR + (addr & (PAGE_SIZE - 1));
+}
+
+bool cpu_hpet_init(void)
+{
+    if (0 == cpu_hpet_virt)
+        return false;
+        
+    // Validate period
+    uint64_t caps = _cpu_hpet_read(HPET_CAPS_OFFSET);
+    uint64_t period = caps >> HPET_CAPS_PERIOD_SHIFT;
+    
+    if (0 == period || period > HPET_PERIOD_MAX)
+        return false;
+        
+    cpu_hpet_period = period;
+    cpu_hpet_mult = (period << 32) / HPET_FS_PER_NS;
+    cpu_hpet_mask = (caps & HPET_CAPS_COUNT_64) ? (uint64_t) -1 : 0xFFFFFFFF;
+    
+    // Restart main counter from zero
+    uint64_t config = _cpu_hpet_read(HPET_CONFIG_OFFSET);
+    _cpu_hpet_write(HPET_CONFIG_OFFSET, config & ~HPET_CONFIG_ENABLE);
+    _cpu_hpet_write(HPET_COUNTER_OFFSET, 0);
+    _cpu_hpet_write(HPET_CONFIG_OFFSET, config | HPET_CONFIG_ENABLE);
+    
+    cpu_hpet_ready = true;
+    return true;
+}
+
+bool cpu_hpet_present(void)
+{
+    return cpu_hpet_ready;
+}
+
+bool cpu_hpet_wide(void)
+{
+    return cpu_hpet_ready && ((uint64_t) -1 == cpu_hpet_mask);
+}
+
+uint64_t cpu_hpet_frequency(void)
+{
+    return (0 != cpu_hpet_period) ? HPET_FS_PER_SECOND / cpu_hpet_period : 0;
+}
+
+uint64_t cpu_hpet_read(void)
+{
+    return _cpu_hpet_read(HPET_COUNTER_OFFSET) & cpu_hpet_mask;
+}
+
+uint64_t cpu_hpet_elapsed_ns(uint64_t begin)
+{
+    return _cpu_hpet_to_ns((cpu_hpet_read() - begin) & cpu_hpet_mask);
+}
+
+uint64_t cpu_hpet_ns(void)
+{
+    return _cpu_hpet_to_ns(cpu_hpet_read());
+}
@@ -0,0 +1,117 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+#pragma once
+#include <api/types.h>
+
+//----------------------------------------------------------------------------//
+// HPET - Constants
+//----------------------------------------------------------------------------//
+
+/**
+ * The virtual address the HPET's registers are mapped to; the page below the
+ * temporary ACPI mappings, clear of the auxiliary page slots.
+ */
+#define HPET_VIRTUAL_ADDR           0xFFFFFF7FFFDFF000
+
+/**
+ * Largest valid counter period in femtoseconds (100 ns).
+ */
+#define HPET_PERIOD_MAX             0x05F5E100
+
+//----------------------------------------------------------------------------//
+// HPET - Registers
+//----------------------------------------------------------------------------//
+
+#define HPET_CAPS_OFFSET            0x000
+#define HPET_CONFIG_OFFSET          0x010
+#define HPET_COUNTER_OFFSET         0x0F0
+
+#define HPET_CAPS_COUNT_64          (1 << 13)
+#define HPET_CAPS_PERIOD_SHIFT      32
+
+#define HPET_CONFIG_ENABLE          (1 << 0)
+
+//----------------------------------------------------------------------------//
+// HPET
+//----------------------------------------------------------------------------//
+
+/**
+ * Sets the physical address of the HPET found in the ACPI tables and maps
+ * its registers.
+ *
+ * @param addr The physical address of the HPET's registers.
+ */
+void cpu_hpet_set(uintptr_t addr);
+
+/**
+ * Validates the HPET's counter period and starts its main counter.
+ *
+ * Only to be called once on the BSP.
+ *
+ * @return Whether a usable HPET is present.
+ */
+bool cpu_hpet_init(void);
+
+/**
+ * Checks whether a usable HPET is present and running.
+ *
+ * @return Whether the HPET can be used.
+ */
+bool cpu_hpet_present(void);
+
+/**
+ * Checks whether the HPET's main counter is 64 bits wide, so it does not
+ * wrap around in practice.
+ *
+ * @return Whether the main counter is 64 bits wide.
+ */
+bool cpu_hpet_wide(void);
+
+/**
+ * Returns the frequency of the HPET's main counter.
+ *
+ * @return The frequency in Hz.
+ */
+uint64_t cpu_hpet_frequency(void);
+
+/**
+ * Reads the HPET's main counter.
+ *
+ * @return The counter's value.
+ */
+uint64_t cpu_hpet_read(void);
+
+/**
+ * Returns the nanoseconds passed since the main counter had the given value.
+ *
+ * Handles a single wrap-around of 32 bit counters.
+ *
+ * @param begin A value previously returned by <tt>cpu_hpet_read</tt>.
+ * @return The time passed in nanoseconds.
+ */
+uint64_t cpu_hpet_elapsed_ns(uint64_t begin);
+
+/**
+ * Returns the nanoseconds passed since the HPET has been started.
+ *
+ * Only meaningful with a 64 bit main counter.
+ *
+ * @return The time in nanoseconds.
+ */
+uint64_t cpu_hpet_ns(void);
@@ -0,0 +1,253 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+
+#include <api/types.h>
+#include <api/compiler.h>
+#include <api/cpu.h>
+
+#include <api/cpu/int.h>
+
+#include <api/debug/console.h>
+
+#include <amd64/cpu.h>
+#include <amd64/cpu/features.h>
+#include <amd64/cpu/idle.h>
+#include <amd64/cpu/int.h>
+#include <amd64/cpu/ipi.h>
+#include <amd64/cpu/lapic.h>
+
+//----------------------------------------------------------------------------//
+// Idle - Structures
+//----------------------------------------------------------------------------//
+
+/**
+ * Idle state of a CPU.
+ */
+typedef struct cpu_idle_cpu_t
+{
+    /**
+     * Wakeup flag monitored while asleep; set by the CPU waking it.
+     */
+    volatile uint32_t wake;
+    
+    /**
+     * Whether the CPU is about to sleep or asleep.
+     */
+    volatile bool idle;
+    
+    /**
+     * Statistics; only written by the CPU itself.
+     */
+    cpu_idle_stats_t stats ALIGNED(CACHE_LINE_SIZE);
+    
+} ALIGNED(CACHE_LINE_SIZE) cpu_idle_cpu_t;
+
+//----------------------------------------------------------------------------//
+// Idle - Variables
+//----------------------------------------------------------------------------//
+
+/**
+ * Idle state per CPU, indexed by the CPU's logical number.
+ */
+static cpu_idle_cpu_t _cpu_idle_cpus[MAX_CPUS];
+
+/**
+ * Number of idle CPUs.
+ */
+static volatile uint32_t _cpu_idle_count = 0;
+
+/**
+ * Whether to sleep with MWAIT, and the hint selecting its C-state.
+ */
+static bool _cpu_idle_mwait = false;
+static uint32_t _cpu_idle_hint = 0;
+
+/**
+ * TSC at initialization, the base of residency percentages.
+ */
+static uint64_t _cpu_idle_begin = 0;
+
+//----------------------------------------------------------------------------//
+// Idle - Internal
+//----------------------------------------------------------------------------//
+
+/**
+ * Returns the MWAIT hint for the deepest C-state with enumerated sub-states.
+ *
+ * @return The hint (C1 if the extensions are not enumerated).
+ */
+static uint32_t _cpu_idle_deepest_hint(void)
+{
+    cpu_cpuid_t regs;
+    cpu_cpuid(0x05, 0, &regs);
+    
+    if (0 == (regs.ecx & IDLE_MWAIT_EMX))
+        return 0;
+        
+    // EDX holds the number of sub-states of C0 to C7 (4 bits each)
+    uint32_t state;
+    
+    for (state = 7; state > 0; --state) {
+        uint32_t substates = (regs.edx >> (state * 4)) & 0xF;
+        
+        if (0 != substates)
+            return ((state - 1) << 4) | (substates - 1);
+    }
+    
+    return 0;
+}
+
+/**
+ * IRQ handler of the wakeup IPI; the interrupt itself ends HLT.
+ *
+ * @param vector The interrupt vector.
+ */
+static void _cpu_idle_irq(interrupt_vector_t vector)
+{
+    cpu_lapic_eoi();
+}
+
+//----------------------------------------------------------------------------//
+// Idle
+//----------------------------------------------------------------------------//
+
+void cpu_idle_init(void)
+{
+    // MWAIT with the deepest C-state or HLT
+    if (cpu_feature_present(CPU_FEATURE_MONITOR)) {
+        _cpu_idle_mwait = true;
+        _cpu_idle_hint = _cpu_idle_deepest_hint();
+    }
+    
+    cpu_int_register_irq(INT_VECTOR_WAKEUP, &_cpu_idle_irq);
+    _cpu_idle_begin = cpu_tsc_read();
+    
+    console_debug("[CPU ] Idle: ");
+    
+    if (_cpu_idle_mwait) {
+        console_debug("MWAIT, hint ");
+        console_debug_hex(_cpu_idle_hint);
+    } else
+        console_debug("HLT");
+        
+    console_debug("\n");
+}
+
+void cpu_idle(bool (*pending)(void))
+{
+    cpu_idle_cpu_t *idle = &_cpu_idle_cpus[cpu_current_index()];
+    
+    // Announce before checking for work (the locked add orders both), so work
+    // made available afterwards is followed by a kick
+    cpu_set_interruptable(false);
+    idle->wake = 0;
+    idle->idle = true;
+    __sync_fetch_and_add(&_cpu_idle_count, 1);
+    
+    // Watch the wakeup flag
+    if (_cpu_idle_mwait)
+        asm volatile ("monitor" :: "a" (&idle->wake), "c" (0), "d" (0));
+        
+    // Sleep, unless kicked or work arrived meanwhile; STI only takes effect
+    // after the next instruction, so no interrupt is missed
+    if (0 == idle->wake && !pending()) {
+        uint64_t begin = cpu_tsc_read();
+        
+        if (_cpu_idle_mwait)
+            asm volatile ("sti; mwait" :: "a" (_cpu_idle_hint), "c" (0));
+        else
+            asm volatile ("sti; hlt");
+            
+        cpu_set_interruptable(false);
+        
+        idle->stats.cycles += cpu_tsc_read() - begin;
+        ++idle->stats.entries;
+    }
+    
+    idle->idle = false;
+    __sync_fetch_and_sub(&_cpu_idle_count, 1);
+    
+    cpu_set_interruptable(true);
+}
+
+void cpu_idle_kick(void)
+{
+    // Order the new work before reading the idle states
+    __sync_synchronize();
+    
+    if (0 == _cpu_idle_count)
+        return;
+        
+    // Wake the next idle CPU not yet kicked
+    size_t self = cpu_current_index();
+    size_t count = cpu_count();
+    size_t offset;
+    
+    for (offset = 1; offset < count; ++offset) {
+        size_t index = (self + offset) % count;
+        cpu_idle_cpu_t *idle = &_cpu_idle_cpus[index];
+        
+        if (!idle->idle || !__sync_bool_compare_and_swap(&idle->wake, 0, 1))
+            continue;
+            
+        // MWAIT ends on the write; HLT needs an interrupt
+        if (!_cpu_idle_mwait)
+            cpu_ipi(
+                INT_VECTOR_WAKEUP,          // Vector
+                cpu_get_index(index)->id,   // Destination
+                IPI_DEST_DEST_FIELD,        // Destination shorthand
+                IPI_MODE_PHYSICAL,          // Destination mode
+                IPI_DELIVERY_FIXED,         // Delivery mode
+                IPI_LEVEL_ASSERT,           // Level
+                cpu_current());             // Current CPU
+                
+        return;
+    }
+}
+
+bool cpu_idle_stats(cpu_id_t cpu, cpu_idle_stats_t *stats)
+{
+    cpu_t *info = cpu_get(cpu);
+    
+    if (0 == info)
+        return false;
+        
+    stats->entries = _cpu_idle_cpus[info->index].stats.entries;
+    stats->cycles = _cpu_idle_cpus[info->index].stats.cycles;
+    
+    return true;
+}
+
+void cpu_idle_stats_dump(void)
+{
+    uint64_t elapsed = cpu_tsc_read() - _cpu_idle_begin;
+    size_t i;
+    
+    for (i = 0; i < cpu_count(); ++i) {
+        cpu_idle_stats_t *stats = &_cpu_idle_cpus[i].stats;
+        
+        console_print("[IDLE] CPU ");
+        console_print_hex(cpu_get_index(i)->id);
+        console_print(": ");
+        console_print_dec((intptr_t) (stats->cycles / (elapsed / 100 + 1)));
+        console_print("% idle in ");
+        console_print_dec((intptr_t) stats->entries);
+        console_print(" sleeps\n");
+    }
+}
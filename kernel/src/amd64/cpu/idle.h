@@ -0,0 +1,95 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+#pragma once
+#include <api/types.h>
+#include <api/cpu.h>
+
+//----------------------------------------------------------------------------//
+// Idle - Constants
+//----------------------------------------------------------------------------//
+
+/**
+ * Bits of <tt>ECX</tt> of leaf 0x05: MWAIT extensions are enumerated, and
+ * interrupts break MWAIT even when masked.
+ */
+#define IDLE_MWAIT_EMX              (1 << 0)
+#define IDLE_MWAIT_IBE              (1 << 1)
+
+//----------------------------------------------------------------------------//
+// Idle - Structures
+//----------------------------------------------------------------------------//
+
+/**
+ * Idle statistics of a CPU.
+ */
+typedef struct cpu_idle_stats_t
+{
+    /**
+     * Number of times the CPU went to sleep.
+     */
+    uint64_t entries;
+    
+    /**
+     * TSC cycles spent asleep.
+     */
+    uint64_t cycles;
+    
+} cpu_idle_stats_t;
+
+//----------------------------------------------------------------------------//
+// Idle
+//----------------------------------------------------------------------------//
+
+/**
+ * Selects MWAIT with the deepest C-state supported, or HLT if MWAIT is not
+ * available, and installs the wakeup IPI handler.
+ *
+ * Only to be called once on the BSP before the APs are started.
+ */
+void cpu_idle_init(void);
+
+/**
+ * Puts the current CPU to sleep until an interrupt arrives or another CPU
+ * kicks it, unless work is pending.
+ *
+ * @param pending Checks whether work is pending; called with interrupts
+ *  disabled after the CPU has been marked idle.
+ */
+void cpu_idle(bool (*pending)(void));
+
+/**
+ * Wakes one sleeping CPU, if any, after work has been made available to it.
+ *
+ * Sets the CPU's monitored wakeup flag, or sends an IPI if it sleeps in HLT.
+ */
+void cpu_idle_kick(void);
+
+/**
+ * Returns the idle statistics of the given CPU.
+ *
+ * @param cpu The CPU's id.
+ * @param stats Structure to copy the statistics to.
+ * @return Whether the CPU exists.
+ */
+bool cpu_idle_stats(cpu_id_t cpu, cpu_idle_stats_t *stats);
+
+/**
+ * Prints the idle residency of all CPUs.
+ */
+void cpu_idle_stats_dump(void);
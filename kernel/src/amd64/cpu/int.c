@@ -25,19 +25,62 @@
 
 #include <api/debug/console.h>
 
+#include <amd64/cpu.h>
 #include <amd64/cpu/int.h>
+#include <amd64/cpu/defer.h>
 
 //----------------------------------------------------------------------------//
 // Variables
 //----------------------------------------------------------------------------//
 
-static cpu_int_entry_t cpu_int_idt[255];
-static uintptr_t cpu_int_handlers[255];
+static cpu_int_entry_t cpu_int_idt[256];
+static uintptr_t cpu_int_handlers[256];
+
+/**
+ * Handlers for IRQs registered for the fast path (called from ASM).
+ */
+irq_handler_t _cpu_int_irq_handlers[256];
+
+#ifdef __INT_STATS__
+/**
+ * Actual fast path IRQ handlers, called by the statistics wrapper.
+ */
+static irq_handler_t cpu_int_irq_targets[256];
+#endif
 
 //----------------------------------------------------------------------------//
 // Internal
 //----------------------------------------------------------------------------//
 
+/**
+ * Points the IDT entry for the given vector to the given stub.
+ *
+ * @param vector The vector of the entry.
+ * @param offset The address of the stub.
+ */
+static void _cpu_int_set_stub(interrupt_vector_t vector, uintptr_t offset)
+{
+    cpu_int_entry_t *entry = &cpu_int_idt[vector];
+    
+    entry->offsetLow = (uint16_t) offset;
+    entry->offsetMiddle = (uint16_t) (offset >> 16);
+    entry->offsetHigh = (uint32_t) (offset >> 32);
+}
+
+#ifdef __INT_STATS__
+/**
+ * Fast path IRQ handler that records statistics for the actual handler.
+ *
+ * @param vector The vector of the interrupt.
+ */
+static void _cpu_int_irq_stats(interrupt_vector_t vector)
+{
+    uint64_t begin = cpu_tsc_read();
+    cpu_int_irq_targets[vector](vector);
+    cpu_int_stats_record(vector, cpu_tsc_read() - begin);
+}
+#endif
+
 /**
  * Writes the given IDT pointer to the IDT register.
  *
@@ -58,22 +101,25 @@ static void _cpu_int_flush(cpu_int_pointer_t ptr)
  */
 extern uintptr_t _cpu_int_handlers[256];
 
+/**
+ * Fast path IRQ handlers defined in ASM (null for exceptions).
+ */
+extern uintptr_t _cpu_int_irq_stubs[256];
+
 void cpu_int_init()
 {
-    // Clear handler function table
+    // Clear handler function tables
     memset((void *) &cpu_int_handlers, 0, sizeof(uintptr_t) * 256);
+    memset((void *) &_cpu_int_irq_handlers, 0, sizeof(irq_handler_t) * 256);
     
     // Setup table
     memset((void *) &cpu_int_idt, 0, sizeof(cpu_int_entry_t) * 256);
     
     size_t vector;
     for (vector = 0; vector < 256; ++vector) {
-        uintptr_t offset = _cpu_int_handlers[vector];
         cpu_int_entry_t *entry = &cpu_int_idt[vector];
         
-        entry->offsetLow = (uint16_t) offset;
-        entry->offsetMiddle = (uint16_t) (offset >> 16);
-        entry->offsetHigh = (uint32_t) (offset >> 32);
+        _cpu_int_set_stub(vector, _cpu_int_handlers[vector]);
         entry->zero0 = entry->zero1 = 0;
         entry->cs = 0x08;
         entry->flags = 0x8E;
@@ -93,7 +139,25 @@ void cpu_int_load(void)
 
 void cpu_int_register(interrupt_vector_t vector, interrupt_handler_t handler)
 {
+    // Set handler before pointing the IDT entry to the full path
     cpu_int_handlers[vector] = (uintptr_t) handler;
+    _cpu_int_set_stub(vector, _cpu_int_handlers[vector]);
+}
+
+void cpu_int_register_irq(interrupt_vector_t vector, irq_handler_t handler)
+{
+    // Exceptions always use the full path
+    if (vector < INT_EXCEPTION_COUNT)
+        return;
+        
+    // Set handler before pointing the IDT entry to the fast path
+#ifdef __INT_STATS__
+    cpu_int_irq_targets[vector] = handler;
+    _cpu_int_irq_handlers[vector] = &_cpu_int_irq_stats;
+#else
+    _cpu_int_irq_handlers[vector] = handler;
+#endif
+    _cpu_int_set_stub(vector, _cpu_int_irq_stubs[vector]);
 }
 
 uintptr_t _cpu_int_handler(cpu_int_state_t *regs)
@@ -101,13 +165,30 @@ uintptr_t _cpu_int_handler(cpu_int_state_t *regs)
     // Handler for vector?
     interrupt_vector_t vector = regs->vector;
     
-    if (0 == cpu_int_handlers[vector])
+    if (0 == cpu_int_handlers[vector]) {
+#ifdef __INT_STATS__
+        // Count unhandled interrupts as well
+        cpu_int_stats_record(vector, 0);
+#endif
         return regs;
+    }
+    
+#ifdef __INT_STATS__
+    uint64_t begin = cpu_tsc_read();
+#endif
         
     // Call handler
     interrupt_handler_t handler = (interrupt_handler_t) cpu_int_handlers[vector];
     regs = (cpu_int_state_t *) (*handler)(vector, (void *) regs);
     
+#ifdef __INT_STATS__
+    cpu_int_stats_record(vector, cpu_tsc_read() - begin);
+#endif
+    
+    // Run deferred work on IRQ exit
+    if (vector >= INT_EXCEPTION_COUNT)
+        cpu_defer_run();
+    
     return regs;
 }
 
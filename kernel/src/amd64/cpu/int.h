@@ -19,15 +19,20 @@
 #pragma once
 #include <api/types.h>
 #include <api/compiler.h>
+#include <api/cpu/int.h>
 
 //----------------------------------------------------------------------------//
 // Interrupt - Vectors
 //----------------------------------------------------------------------------//
 
+#define INT_EXCEPTION_COUNT         0x20
 #define INT_PIC_IRQ_OFFSET          0x40
 #define INT_VECTOR_APIC_ERROR       0x21
 #define INT_VECTOR_TIMER            0x31
 #define INT_VECTOR_TIMER_HELPER     0x32
+#define INT_VECTOR_DEFER            0x33
+#define INT_VECTOR_WAKEUP           0x34
+#define INT_VECTOR_TLB              0x35
 
 //----------------------------------------------------------------------------//
 // Interrupt - Structures
@@ -117,3 +122,58 @@ void cpu_int_init(void);
  * Loads the system's IDT and starts interrupt handling that way.
  */
 void cpu_int_load(void);
+
+//----------------------------------------------------------------------------//
+// Interrupt - Statistics
+//----------------------------------------------------------------------------//
+
+/**
+ * Number of buckets of the handler duration histograms. Bucket <tt>i</tt>
+ * counts handler runs that took <tt>[2^i, 2^(i + 1))</tt> cycles.
+ */
+#define INT_STATS_BUCKETS           32
+
+/**
+ * Per-CPU interrupt statistics.
+ */
+typedef struct cpu_int_stats_t
+{
+    /**
+     * Number of interrupts per vector.
+     */
+    uint64_t count[256];
+    
+    /**
+     * Total cycles spent in the handlers per vector.
+     */
+    uint64_t cycles[256];
+    
+    /**
+     * Longest handler run per vector (in cycles).
+     */
+    uint64_t max[256];
+    
+    /**
+     * Handler duration histograms per vector.
+     */
+    uint32_t histogram[256][INT_STATS_BUCKETS];
+    
+} cpu_int_stats_t;
+
+/**
+ * Allocates the interrupt statistics for all CPUs and starts recording.
+ *
+ * Only to be called once on the BSP after all CPUs have been added. Does
+ * nothing unless built with <tt>__INT_STATS__</tt>.
+ */
+void cpu_int_stats_init(void);
+
+/**
+ * Records a handled interrupt on the current CPU.
+ *
+ * Lock-free, as every CPU only writes its own statistics.
+ *
+ * @param vector The vector of the interrupt.
+ * @param cycles The cycles spent in the handler.
+ */
+void cpu_int_stats_record(interrupt_vector_t vector, uint64_t cycles);
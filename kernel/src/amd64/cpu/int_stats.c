@@ -0,0 +1,167 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+
+#include <api/types.h>
+#include <api/string.h>
+#include <api/cpu.h>
+
+#include <api/cpu/int.h>
+
+#include <api/memory/heap.h>
+
+#include <api/debug/console.h>
+
+#include <amd64/cpu.h>
+#include <amd64/cpu/int.h>
+
+#ifdef __INT_STATS__
+
+//----------------------------------------------------------------------------//
+// Variables
+//----------------------------------------------------------------------------//
+
+/**
+ * Statistics per CPU, indexed by the CPU's logical number.
+ */
+static cpu_int_stats_t *cpu_int_stats[MAX_CPUS];
+
+/**
+ * Whether the statistics have been allocated.
+ */
+static bool cpu_int_stats_ready = false;
+
+//----------------------------------------------------------------------------//
+// Internal
+//----------------------------------------------------------------------------//
+
+/**
+ * Returns the histogram bucket for the given handler duration.
+ *
+ * @param cycles The handler duration in cycles.
+ * @return The index of the bucket.
+ */
+static size_t _cpu_int_stats_bucket(uint64_t cycles)
+{
+    size_t bucket = 63 - __builtin_clzll(cycles | 1);
+    
+    if (bucket >= INT_STATS_BUCKETS)
+        bucket = INT_STATS_BUCKETS - 1;
+        
+    return bucket;
+}
+
+/**
+ * Prints the statistics of the given CPU.
+ *
+ * @param cpu The CPU.
+ * @param stats The CPU's statistics.
+ */
+static void _cpu_int_stats_dump_cpu(cpu_t *cpu, cpu_int_stats_t *stats)
+{
+    size_t vector, bucket;
+    
+    for (vector = 0; vector < 256; ++vector) {
+        uint64_t count = stats->count[vector];
+        
+        if (0 == count)
+            continue;
+            
+        // Summary
+        console_print("[INT ] CPU ");
+        console_print_hex(cpu->id);
+        console_print(" vector ");
+        console_print_hex(vector);
+        console_print(": ");
+        console_print_dec((intptr_t) count);
+        console_print(" times, avg ");
+        console_print_dec((intptr_t) (stats->cycles[vector] / count));
+        console_print(" max ");
+        console_print_dec((intptr_t) stats->max[vector]);
+        console_print(" cycles\n");
+        
+        // Histogram (non-empty buckets only)
+        for (bucket = 0; bucket < INT_STATS_BUCKETS; ++bucket) {
+            if (0 == stats->histogram[vector][bucket])
+                continue;
+                
+            console_print("       < 2^");
+            console_print_dec((intptr_t) bucket + 1);
+            console_print(": ");
+            console_print_dec((intptr_t) stats->histogram[vector][bucket]);
+            console_print("\n");
+        }
+    }
+}
+
+#endif
+
+//----------------------------------------------------------------------------//
+// Statistics
+//----------------------------------------------------------------------------//
+
+void cpu_int_stats_init(void)
+{
+#ifdef __INT_STATS__
+    size_t i;
+    
+    for (i = 0; i < cpu_count(); ++i) {
+        cpu_int_stats_t *stats = malloc(sizeof(cpu_int_stats_t));
+        memset(stats, 0, sizeof(cpu_int_stats_t));
+        cpu_int_stats[i] = stats;
+    }
+    
+    cpu_int_stats_ready = true;
+#endif
+}
+
+void cpu_int_stats_record(interrupt_vector_t vector, uint64_t cycles)
+{
+#ifdef __INT_STATS__
+    // Not allocated yet?
+    if (!cpu_int_stats_ready)
+        return;
+        
+    cpu_int_stats_t *stats = cpu_int_stats[cpu_current_index()];
+    
+    if (0 == stats)
+        return;
+        
+    // Update counters
+    ++stats->count[vector];
+    stats->cycles[vector] += cycles;
+    
+    if (cycles > stats->max[vector])
+        stats->max[vector] = cycles;
+        
+    ++stats->histogram[vector][_cpu_int_stats_bucket(cycles)];
+#endif
+}
+
+void cpu_int_stats_dump(void)
+{
+#ifdef __INT_STATS__
+    size_t i;
+    
+    for (i = 0; i < cpu_count(); ++i)
+        if (0 != cpu_int_stats[i])
+            _cpu_int_stats_dump_cpu(cpu_get_index(i), cpu_int_stats[i]);
+#else
+    console_print("[INT ] Statistics not available (build with INT_STATS=1)\n");
+#endif
+}
@@ -0,0 +1,318 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+
+#include <api/types.h>
+#include <api/cpu.h>
+
+#include <api/cpu/irq.h>
+
+#include <api/memory/page.h>
+
+#include <api/sync/spinlock.h>
+
+#include <amd64/memory/page.h>
+
+#include <amd64/cpu/ioapic.h>
+#include <amd64/cpu/lapic.h>
+
+//----------------------------------------------------------------------------//
+// I/O APIC - Structures
+//----------------------------------------------------------------------------//
+
+/**
+ * An I/O APIC.
+ */
+typedef struct cpu_ioapic_t
+{
+    /**
+     * The I/O APIC's id.
+     */
+    uint8_t id;
+    
+    /**
+     * Virtual address of the registers.
+     */
+    uintptr_t virt;
+    
+    /**
+     * First GSI and number of inputs.
+     */
+    uint32_t gsi_base, gsi_count;
+    
+    /**
+     * Lock for the indirect register access.
+     */
+    spinlock_t lock;
+    
+} cpu_ioapic_t;
+
+/**
+ * An interrupt source override.
+ */
+typedef struct cpu_ioapic_override_t
+{
+    uint32_t gsi;
+    uint16_t flags;
+    bool present;
+} cpu_ioapic_override_t;
+
+//----------------------------------------------------------------------------//
+// I/O APIC - Variables
+//----------------------------------------------------------------------------//
+
+static cpu_ioapic_t cpu_ioapics[IOAPIC_MAX];
+static size_t cpu_ioapic_len = 0;
+
+/**
+ * Overrides of the ISA IRQs, indexed by IRQ.
+ */
+static cpu_ioapic_override_t cpu_ioapic_overrides[IOAPIC_ISA_IRQS];
+
+//----------------------------------------------------------------------------//
+// I/O APIC - Internal
+//----------------------------------------------------------------------------//
+
+static uint32_t _cpu_ioapic_read(cpu_ioapic_t *ioapic, uint8_t reg)
+{
+    *((volatile uint32_t *) (ioapic->virt + IOAPIC_REGSEL_OFFSET)) = reg;
+    return *((volatile uint32_t *) (ioapic->virt + IOAPIC_WINDOW_OFFSET));
+}
+
+static void _cpu_ioapic_write(cpu_ioapic_t *ioapic, uint8_t reg, uint32_t value)
+{
+    *((volatile uint32_t *) (ioapic->virt + IOAPIC_REGSEL_OFFSET)) = reg;
+    *((volatile uint32_t *) (ioapic->virt + IOAPIC_WINDOW_OFFSET)) = value;
+}
+
+/**
+ * Returns the I/O APIC handling the given GSI.
+ *
+ * @param gsi The GSI.
+ * @return The I/O APIC or a null-pointer, if there is none.
+ */
+static cpu_ioapic_t *_cpu_ioapic_for(uint32_t gsi)
+{
+    size_t i;
+    
+    for (i = 0; i < cpu_ioapic_len; ++i) {
+        cpu_ioapic_t *ioapic = &cpu_ioapics[i];
+        
+        if (gsi >= ioapic->gsi_base && gsi - ioapic->gsi_base < ioapic->gsi_count)
+            return ioapic;
+    }
+    
+    return 0;
+}
+
+/**
+ * Determines the polarity and trigger mode bits of the redirection entry for
+ * the given GSI.
+ *
+ * ISA IRQs default to active high, edge triggered; all other GSIs (PCI) to
+ * active low, level triggered. Overrides replace the defaults.
+ *
+ * @param gsi The GSI.
+ * @return The redirection entry bits.
+ */
+static uint64_t _cpu_ioapic_mode(uint32_t gsi)
+{
+    // Defaults
+    uint16_t polarity = (gsi < IOAPIC_ISA_IRQS) ? IOAPIC_POLARITY_HIGH : IOAPIC_POLARITY_LOW;
+    uint16_t trigger = (gsi < IOAPIC_ISA_IRQS) ? IOAPIC_TRIGGER_EDGE : IOAPIC_TRIGGER_LEVEL;
+    
+    // Overridden?
+    size_t i;
+    
+    for (i = 0; i < IOAPIC_ISA_IRQS; ++i) {
+        cpu_ioapic_override_t *override = &cpu_ioapic_overrides[i];
+        
+        if (!override->present || override->gsi != gsi)
+            continue;
+            
+        // Conforming to the bus (ISA) keeps the defaults
+        if (0 != (override->flags & IOAPIC_POLARITY_MASK))
+            polarity = override->flags & IOAPIC_POLARITY_MASK;
+            
+        if (0 != (override->flags & IOAPIC_TRIGGER_MASK))
+            trigger = override->flags & IOAPIC_TRIGGER_MASK;
+            
+        break;
+    }
+    
+    uint64_t mode = 0;
+    
+    if (IOAPIC_POLARITY_LOW == polarity)
+        mode |= IOAPIC_RED_ACTIVE_LOW;
+        
+    if (IOAPIC_TRIGGER_LEVEL == trigger)
+        mode |= IOAPIC_RED_LEVEL;
+        
+    return mode;
+}
+
+/**
+ * Sets or clears the mask bit of the redirection entry of the given GSI.
+ *
+ * @param gsi The GSI.
+ * @param masked Whether to mask the GSI.
+ */
+static void _cpu_ioapic_set_masked(uint32_t gsi, bool masked)
+{
+    cpu_ioapic_t *ioapic = _cpu_ioapic_for(gsi);
+    
+    if (0 == ioapic)
+        return;
+        
+    uint8_t reg = IOAPIC_REG_REDTBL(gsi - ioapic->gsi_base);
+    
+    spinlock_acquire(&ioapic->lock);
+    
+    uint32_t lower = _cpu_ioapic_read(ioapic, reg);
+    
+    if (masked)
+        lower |= IOAPIC_RED_MASKED;
+    else
+        lower &= ~IOAPIC_RED_MASKED;
+        
+    _cpu_ioapic_write(ioapic, reg, lower);
+    
+    spinlock_release(&ioapic->lock);
+}
+
+//----------------------------------------------------------------------------//
+// I/O APIC
+//----------------------------------------------------------------------------//
+
+void cpu_ioapic_add(uint8_t id, uintptr_t addr, uint32_t gsi_base)
+{
+    // Too many I/O APICs?
+    if (cpu_ioapic_len >= IOAPIC_MAX)
+        return;
+        
+    cpu_ioapic_t *ioapic = &cpu_ioapics[cpu_ioapic_len];
+    
+    // Map registers
+    ioapic->virt = IOAPIC_VIRTUAL_ADDR + cpu_ioapic_len * PAGE_SIZE;
+    page_map(
+        ioapic->virt,
+        addr & ~(PAGE_SIZE - 1),
+        PG_GLOBAL | PG_PRESENT | PG_WRITABLE | PG_CACHE_DISABLE);
+    ioapic->virt += addr & (PAGE_SIZE - 1);
+    
+    // Read number of inputs (maximum redirection entry in bits 16-23)
+    ioapic->id = id;
+    ioapic->gsi_base = gsi_base;
+    ioapic->gsi_count = ((_cpu_ioapic_read(ioapic, IOAPIC_REG_VERSION) >> 16) & 0xFF) + 1;
+    ioapic->lock.lock = 0;
+    ioapic->lock.flags = 0;
+    
+    ++cpu_ioapic_len;
+}
+
+void cpu_ioapic_override(uint8_t irq, uint32_t gsi, uint16_t flags)
+{
+    if (irq >= IOAPIC_ISA_IRQS)
+        return;
+        
+    cpu_ioapic_overrides[irq].gsi = gsi;
+    cpu_ioapic_overrides[irq].flags = flags;
+    cpu_ioapic_overrides[irq].present = true;
+}
+
+void cpu_ioapic_init(void)
+{
+    size_t i, j;
+    
+    for (i = 0; i < cpu_ioapic_len; ++i) {
+        cpu_ioapic_t *ioapic = &cpu_ioapics[i];
+        
+        for (j = 0; j < ioapic->gsi_count; ++j) {
+            _cpu_ioapic_write(ioapic, IOAPIC_REG_REDTBL(j) + 1, 0);
+            _cpu_ioapic_write(ioapic, IOAPIC_REG_REDTBL(j), IOAPIC_RED_MASKED);
+        }
+    }
+}
+
+size_t cpu_ioapic_count(void)
+{
+    return cpu_ioapic_len;
+}
+
+//----------------------------------------------------------------------------//
+// IRQ Routing
+//----------------------------------------------------------------------------//
+
+uint32_t cpu_irq_gsi(uint8_t irq)
+{
+    if (irq < IOAPIC_ISA_IRQS && cpu_ioapic_overrides[irq].present)
+        return cpu_ioapic_overrides[irq].gsi;
+        
+    return irq;
+}
+
+bool cpu_irq_route(
+    uint32_t gsi, interrupt_vector_t vector, uint8_t delivery,
+    const cpu_id_t *cpus, size_t count)
+{
+    // Find I/O APIC
+    cpu_ioapic_t *ioapic = _cpu_ioapic_for(gsi);
+    
+    if (0 == ioapic || 0 == count || vector < 0x20)
+        return false;
+        
+    // Build destination: a set of logical ids for lowest priority delivery...
+    uint64_t entry = vector | _cpu_ioapic_mode(gsi);
+    uint8_t logical = 0;
+    size_t i;
+    
+    if (IRQ_DELIVERY_LOWEST == delivery)
+        for (i = 0; i < count; ++i)
+            logical |= cpu_lapic_logical_id(cpus[i]);
+    
+    if (0 != logical) {
+        entry |= (IRQ_DELIVERY_LOWEST << IOAPIC_RED_DELIVERY_SHIFT) | IOAPIC_RED_LOGICAL;
+        entry |= ((uint64_t) logical) << IOAPIC_RED_DEST_SHIFT;
+        
+    // ...or the physical id of the first CPU (8 bits without remapping)
+    } else if (cpus[0] <= 0xFF)
+        entry |= ((uint64_t) cpus[0]) << IOAPIC_RED_DEST_SHIFT;
+    else
+        return false;
+        
+    // Write entry (upper half first, lower half unmasks)
+    uint8_t reg = IOAPIC_REG_REDTBL(gsi - ioapic->gsi_base);
+    
+    spinlock_acquire(&ioapic->lock);
+    _cpu_ioapic_write(ioapic, reg, IOAPIC_RED_MASKED);
+    _cpu_ioapic_write(ioapic, reg + 1, entry >> 32);
+    _cpu_ioapic_write(ioapic, reg, entry & 0xFFFFFFFF);
+    spinlock_release(&ioapic->lock);
+    
+    return true;
+}
+
+void cpu_irq_mask(uint32_t gsi)
+{
+    _cpu_ioapic_set_masked(gsi, true);
+}
+
+void cpu_irq_unmask(uint32_t gsi)
+{
+    _cpu_ioapic_set_masked(gsi, false);
+}
@@ -0,0 +1,110 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+
+#pragma once
+#include <api/types.h>
+
+//----------------------------------------------------------------------------//
+// I/O APIC - Constants
+//----------------------------------------------------------------------------//
+
+/**
+ * The virtual address the first I/O APIC is mapped to; subsequent ones follow
+ * in the next pages.
+ */
+#define IOAPIC_VIRTUAL_ADDR         0xFFFFFF7FFFFE0000
+
+/**
+ * Maximum number of supported I/O APICs.
+ */
+#define IOAPIC_MAX                  16
+
+/**
+ * Number of legacy ISA IRQs.
+ */
+#define IOAPIC_ISA_IRQS             16
+
+//----------------------------------------------------------------------------//
+// I/O APIC - Registers
+//----------------------------------------------------------------------------//
+
+#define IOAPIC_REGSEL_OFFSET        0x00
+#define IOAPIC_WINDOW_OFFSET        0x10
+
+#define IOAPIC_REG_ID               0x00
+#define IOAPIC_REG_VERSION          0x01
+#define IOAPIC_REG_REDTBL(n)        (0x10 + 2 * (n))
+
+//----------------------------------------------------------------------------//
+// I/O APIC - Redirection Entry
+//----------------------------------------------------------------------------//
+
+#define IOAPIC_RED_DELIVERY_SHIFT   8
+#define IOAPIC_RED_LOGICAL          (1 << 11)
+#define IOAPIC_RED_ACTIVE_LOW       (1 << 13)
+#define IOAPIC_RED_LEVEL            (1 << 15)
+#define IOAPIC_RED_MASKED           (1 << 16)
+#define IOAPIC_RED_DEST_SHIFT       56
+
+//----------------------------------------------------------------------------//
+// I/O APIC - Interrupt Source Override Flags
+//----------------------------------------------------------------------------//
+
+#define IOAPIC_POLARITY_MASK        0x3
+#define IOAPIC_POLARITY_HIGH        0x1
+#define IOAPIC_POLARITY_LOW         0x3
+#define IOAPIC_TRIGGER_MASK         0xC
+#define IOAPIC_TRIGGER_EDGE         0x4
+#define IOAPIC_TRIGGER_LEVEL        0xC
+
+//----------------------------------------------------------------------------//
+// I/O APIC
+//----------------------------------------------------------------------------//
+
+/**
+ * Adds an I/O APIC found in the MADT and maps its registers.
+ *
+ * @param id The I/O APIC's id.
+ * @param addr The physical address of its registers.
+ * @param gsi_base The first Global System Interrupt it handles.
+ */
+void cpu_ioapic_add(uint8_t id, uintptr_t addr, uint32_t gsi_base);
+
+/**
+ * Records an interrupt source override found in the MADT.
+ *
+ * @param irq The ISA IRQ that is overridden.
+ * @param gsi The Global System Interrupt the IRQ is connected to.
+ * @param flags The MPS INTI flags (polarity and trigger mode).
+ */
+void cpu_ioapic_override(uint8_t irq, uint32_t gsi, uint16_t flags);
+
+/**
+ * Masks all inputs of all I/O APICs.
+ *
+ * Only to be called once on the BSP; inputs are unmasked when routed.
+ */
+void cpu_ioapic_init(void);
+
+/**
+ * Returns the number of I/O APICs in the system.
+ *
+ * @return Number of I/O APICs.
+ */
+size_t cpu_ioapic_count(void);
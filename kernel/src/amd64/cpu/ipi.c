@@ -27,15 +27,9 @@
 //----------------------------------------------------------------------------//
 
 void cpu_ipi(
-    uint8_t vector, uint8_t dest, uint8_t shorthand,
+    uint8_t vector, cpu_id_t dest, uint8_t shorthand,
     uint8_t mode, uint8_t delivery, uint8_t level, cpu_t *cpu)
 {
-    // Lock CPU
-    spinlock_acquire(&cpu->lock);
-
-    // Get ICR address
-    uintptr_t icr = (uintptr_t) LAPIC_REGISTER(LAPIC_ICR_OFFSET);
-    
     // Lower 32 bits
     uint32_t lower = 
         vector |                    // 0-7      (Vector)
@@ -44,15 +38,15 @@ void cpu_ipi(
         ((level & 0x1) << 14) |     // 14       (Level)
         ((shorthand & 0x3) << 18);  // 18-19    (Destination Shorthand)
         
-    // Upper 32 bits
-    uint32_t upper =
-        dest << (56 - 32);                 // 56-63    (Destination)
+    // x2APIC: single write, no lock required
+    if (cpu_lapic_is_x2apic()) {
+        cpu_lapic_write_icr(lower, dest);
+        return;
+    }
     
-    // Write ICR
-    *((uint32_t *) (icr + 0x10)) = upper; // Be sure to write upper 32 bits first!
-    *((uint32_t *) icr) = lower;
-    
-    // Release lock
+    // Lock CPU, as destination and command are written separately
+    spinlock_acquire(&cpu->lock);
+    cpu_lapic_write_icr(lower, dest);
     spinlock_release(&cpu->lock);
 }
 
@@ -65,7 +59,7 @@ void cpu_ipi_startup(uint16_t addr, cpu_id_t cpu)
         IPI_MODE_PHYSICAL,          // Destination mode
         IPI_DELIVERY_STARTUP,       // Delivery mode
         IPI_LEVEL_ASSERT,           // Level
-        cpu_get(cpu_current_id())); // Current CPI
+        cpu_current());             // Current CPU
 }
 
 void cpu_ipi_broadcast(interrupt_vector_t vector, bool incl_self)
@@ -83,7 +77,7 @@ void cpu_ipi_broadcast(interrupt_vector_t vector, bool incl_self)
         IPI_MODE_PHYSICAL,          // Destination mode
         IPI_DELIVERY_FIXED,         // Delivery mode
         IPI_LEVEL_ASSERT,           // Level
-        cpu_get(cpu_current_id())); // Current CPU        
+        cpu_current());             // Current CPU
 }
 
 void cpu_ipi_single(interrupt_vector_t vector, cpu_id_t cpu)
@@ -96,5 +90,5 @@ void cpu_ipi_single(interrupt_vector_t vector, cpu_id_t cpu)
         IPI_MODE_PHYSICAL,          // Destination mode
         IPI_DELIVERY_FIXED,         // Delivery mode
         IPI_LEVEL_ASSERT,           // Level
-        cpu_get(cpu_current_id())); // Current CPU
+        cpu_current());             // Current CPU
 }
@@ -58,10 +58,11 @@
  * @param mode The interrupt's destination mode. 0 for physical, 1 for logical.
  * @param delivery The interrupt's delivery mode.
  * @param level The interrupt's level. 1 for assert, 0 for de-assert.
- * @param cpu The current CPU structure used for locking.
+ * @param cpu The current CPU structure used for locking (not required in
+ *  x2APIC mode).
  */
 void cpu_ipi(
-    uint8_t vector, uint8_t dest, uint8_t shorthand,
+    uint8_t vector, cpu_id_t dest, uint8_t shorthand,
     uint8_t mode, uint8_t delivery, uint8_t level, cpu_t *cpu);
     
 /**
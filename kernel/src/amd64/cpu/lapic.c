@@ -17,7 +17,10 @@
  */
  
 #include <api/types.h>
+#include <api/cpu.h>
 #include <api/memory/page.h>
+#include <amd64/cpu.h>
+#include <amd64/cpu/features.h>
 #include <amd64/cpu/lapic.h>
 
 //----------------------------------------------------------------------------//
@@ -29,26 +32,119 @@
  */
 static uintptr_t cpu_lapic_addr = 0;
 
+/**
+ * Whether the LAPICs are accessed in x2APIC mode.
+ */
+static bool cpu_lapic_x2apic = false;
+
 //----------------------------------------------------------------------------//
 // LAPIC
 //----------------------------------------------------------------------------//
 
+void cpu_lapic_mode_init(void)
+{
+    uint64_t base = cpu_msr_read(LAPIC_BASE_MSR);
+    
+    // Already enabled by the firmware?
+    if (base & LAPIC_BASE_X2APIC) {
+        cpu_lapic_x2apic = true;
+        return;
+    }
+    
+    // Not supported or decided against on the BSP?
+    if (!cpu_feature_present(CPU_FEATURE_X2APIC))
+        return;
+        
+    // Switch to x2APIC mode (from enabled xAPIC mode)
+    cpu_msr_write(LAPIC_BASE_MSR, base | LAPIC_BASE_ENABLE | LAPIC_BASE_X2APIC);
+    cpu_lapic_x2apic = true;
+}
+
+bool cpu_lapic_is_x2apic(void)
+{
+    return cpu_lapic_x2apic;
+}
+
+uint32_t cpu_lapic_read(uint32_t offset)
+{
+    if (cpu_lapic_x2apic)
+        return (uint32_t) cpu_msr_read(LAPIC_X2APIC_REGISTER(offset));
+        
+    return *LAPIC_REGISTER(offset);
+}
+
+void cpu_lapic_write(uint32_t offset, uint32_t value)
+{
+    if (cpu_lapic_x2apic)
+        cpu_msr_write(LAPIC_X2APIC_REGISTER(offset), value);
+    else
+        *LAPIC_REGISTER(offset) = value;
+}
+
+void cpu_lapic_write_icr(uint32_t command, cpu_id_t dest)
+{
+    if (cpu_lapic_x2apic) {
+        // WRMSR to the ICR is not serializing: order preceding stores first
+        asm volatile ("mfence; lfence" ::: "memory");
+        cpu_msr_write(
+            LAPIC_X2APIC_REGISTER(LAPIC_ICR_OFFSET),
+            (((uint64_t) dest) << 32) | command);
+        return;
+    }
+    
+    // Be sure to write upper 32 bits first!
+    *LAPIC_REGISTER(LAPIC_ICR_OFFSET + 0x10) = dest << (56 - 32);
+    *LAPIC_REGISTER(LAPIC_ICR_OFFSET) = command;
+}
+
+cpu_id_t cpu_lapic_id(void)
+{
+    // Full 32 bit id in x2APIC mode, 8 bits in bits 24-31 otherwise
+    if (cpu_lapic_x2apic)
+        return cpu_lapic_read(LAPIC_ID_OFFSET);
+        
+    return (cpu_lapic_read(LAPIC_ID_OFFSET) >> 24) & 0xFF;
+}
+
 void cpu_lapic_eoi(void)
 {
     // Write arbibrary value to EOI register
-    *LAPIC_REGISTER(LAPIC_EOI_OFFSET) = 0x0;
+    cpu_lapic_write(LAPIC_EOI_OFFSET, 0x0);
 }
 
 void cpu_lapic_enable(void)
 {
+    // Flat logical destination mode (LDR is read-only in x2APIC mode)
+    if (!cpu_lapic_x2apic) {
+        cpu_lapic_write(LAPIC_DFR_OFFSET, 0xFFFFFFFF);
+        cpu_lapic_write(
+            LAPIC_LDR_OFFSET,
+            ((uint32_t) cpu_lapic_logical_id(cpu_current_id())) << 24);
+    }
+    
     // Set APIC Enabled bit in SVR
-    *LAPIC_REGISTER(LAPIC_SVR_OFFSET) |= 0x100;
+    cpu_lapic_write(LAPIC_SVR_OFFSET, cpu_lapic_read(LAPIC_SVR_OFFSET) | 0x100);
 }
 
 void cpu_lapic_disable(void)
 {
     // unset APIC Enabled bit in SVR
-    *LAPIC_REGISTER(LAPIC_SVR_OFFSET) &= ~0x100;
+    cpu_lapic_write(LAPIC_SVR_OFFSET, cpu_lapic_read(LAPIC_SVR_OFFSET) & ~0x100);
+}
+
+uint8_t cpu_lapic_logical_id(cpu_id_t id)
+{
+    // No flat model in x2APIC mode
+    if (cpu_lapic_x2apic)
+        return 0;
+        
+    // One bit per logical number of the first 8 CPUs
+    cpu_t *cpu = cpu_get(id);
+    
+    if (0 == cpu || cpu->index >= 8)
+        return 0;
+        
+    return 1 << cpu->index;
 }
 
 void cpu_lapic_set(uintptr_t addr)
@@ -18,6 +18,7 @@
  
 #pragma once
 #include <api/types.h>
+#include <api/cpu.h>
 
 //----------------------------------------------------------------------------//
 // LAPIC - Constants
@@ -28,6 +29,19 @@
  */
 #define LAPIC_VIRTUAL_ADDR 0xFFFFFF7FFFFFC000
 
+/**
+ * The APIC base MSR and its flags.
+ */
+#define LAPIC_BASE_MSR              0x1B
+#define LAPIC_BASE_X2APIC           (1 << 10)
+#define LAPIC_BASE_ENABLE           (1 << 11)
+
+/**
+ * First MSR of the x2APIC register space; register offsets are mapped to
+ * <tt>LAPIC_X2APIC_MSR + (offset >> 4)</tt>.
+ */
+#define LAPIC_X2APIC_MSR            0x800
+
 //----------------------------------------------------------------------------//
 // LAPIC - Register Offsets
 //----------------------------------------------------------------------------//
@@ -36,6 +50,8 @@
 #define LAPIC_VERSION_OFFSET        0x030
 #define LAPIC_TPR_OFFSET            0x080
 #define LAPIC_EOI_OFFSET            0x0B0
+#define LAPIC_LDR_OFFSET            0x0D0
+#define LAPIC_DFR_OFFSET            0x0E0
 #define LAPIC_SVR_OFFSET            0x0F0
 #define LAPIC_IRR_OFFSET            0x200
 #define LAPIC_ICR_OFFSET            0x300
@@ -51,12 +67,62 @@
 // LAPIC - Macroes
 //----------------------------------------------------------------------------//
 
-#define LAPIC_REGISTER(offset)      ((uint32_t *) (LAPIC_VIRTUAL_ADDR + offset))
+#define LAPIC_REGISTER(offset)      ((volatile uint32_t *) (LAPIC_VIRTUAL_ADDR + offset))
+#define LAPIC_X2APIC_REGISTER(offset) (LAPIC_X2APIC_MSR + ((offset) >> 4))
 
 //----------------------------------------------------------------------------//
 // LAPIC
 //----------------------------------------------------------------------------//
 
+/**
+ * Switches the current processor's LAPIC to x2APIC mode, if supported.
+ *
+ * Must be called on each processor before any other LAPIC access, as the
+ * mode is chosen system-wide on the BSP.
+ */
+void cpu_lapic_mode_init(void);
+
+/**
+ * Returns whether the LAPICs are accessed in x2APIC mode.
+ *
+ * @return Whether x2APIC mode is used.
+ */
+bool cpu_lapic_is_x2apic(void);
+
+/**
+ * Reads a LAPIC register.
+ *
+ * @param offset The offset of the register (<tt>LAPIC_*_OFFSET</tt>).
+ * @return The register's value.
+ */
+uint32_t cpu_lapic_read(uint32_t offset);
+
+/**
+ * Writes a LAPIC register.
+ *
+ * @param offset The offset of the register (<tt>LAPIC_*_OFFSET</tt>).
+ * @param value The value to write.
+ */
+void cpu_lapic_write(uint32_t offset, uint32_t value);
+
+/**
+ * Writes the Interrupt Command Register, sending an IPI.
+ *
+ * In x2APIC mode this is a single MSR write; otherwise the destination is
+ * written before the command and the caller has to serialize access.
+ *
+ * @param command The lower 32 bits of the ICR.
+ * @param dest The id of the destination.
+ */
+void cpu_lapic_write_icr(uint32_t command, cpu_id_t dest);
+
+/**
+ * Returns the id of the current processor's LAPIC.
+ *
+ * @return The LAPIC id (32 bits in x2APIC mode).
+ */
+cpu_id_t cpu_lapic_id(void);
+
 /**
  * Signals the end of an interrupt to the LAPIC.
  */
@@ -64,6 +130,8 @@ void cpu_lapic_eoi(void);
 
 /**
  * Enables the processor's LAPIC.
+ *
+ * Also sets up flat logical destination mode with the CPU's logical id.
  */
 void cpu_lapic_enable(void);
 
@@ -80,6 +148,17 @@ void cpu_lapic_disable(void);
  */
 void cpu_lapic_init(void);
 
+/**
+ * Returns the logical id of a CPU in flat logical destination mode.
+ *
+ * Each of the first eight CPUs is assigned its own bit. In x2APIC mode there
+ * are no flat logical ids.
+ *
+ * @param id The id of the CPU.
+ * @return The logical id or <tt>0</tt>, if the CPU has none.
+ */
+uint8_t cpu_lapic_logical_id(cpu_id_t id);
+
 /**
  * Sets the physical address of the LAPIC.
  *
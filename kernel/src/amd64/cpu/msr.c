@@ -0,0 +1,36 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+ 
+#include <api/types.h>
+#include <amd64/cpu.h>
+
+uint64_t cpu_msr_read(uint32_t msr)
+{
+    uint32_t low, high;
+    asm volatile ("rdmsr" : "=a" (low), "=d" (high) : "c" (msr));
+    return ((uint64_t) high << 32) | low;
+}
+
+void cpu_msr_write(uint32_t msr, uint64_t value)
+{
+    asm volatile (
+        "wrmsr"
+        :: "c" (msr), "a" ((uint32_t) value), "d" ((uint32_t) (value >> 32))
+        : "memory");
+}
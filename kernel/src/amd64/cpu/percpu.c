@@ -0,0 +1,98 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+
+#include <api/types.h>
+#include <api/compiler.h>
+#include <api/string.h>
+#include <api/cpu.h>
+
+#include <api/memory/heap.h>
+
+#include <amd64/cpu.h>
+#include <amd64/cpu/lapic.h>
+#include <amd64/cpu/percpu.h>
+
+//----------------------------------------------------------------------------//
+// Per-CPU Data - Variables
+//----------------------------------------------------------------------------//
+
+PERCPU uintptr_t cpu_percpu_self = 0;
+PERCPU cpu_t *cpu_percpu_cpu = 0;
+PERCPU cpu_id_t cpu_percpu_id = 0;
+PERCPU size_t cpu_percpu_index = 0;
+
+//----------------------------------------------------------------------------//
+// Per-CPU Data - Internal
+//----------------------------------------------------------------------------//
+
+/**
+ * Loads the given per-CPU data area into the current CPU's GS base.
+ *
+ * @param area The address of the area.
+ */
+static void _cpu_percpu_set(uintptr_t area)
+{
+    cpu_msr_write(PERCPU_GS_BASE_MSR, area);
+    cpu_msr_write(PERCPU_KERNEL_GS_BASE_MSR, 0);
+}
+
+//----------------------------------------------------------------------------//
+// Per-CPU Data
+//----------------------------------------------------------------------------//
+
+void cpu_percpu_boot(void)
+{
+    uintptr_t area = (uintptr_t) &cpu_percpu_template;
+    _cpu_percpu_set(area);
+    percpu_write(cpu_percpu_self, area);
+}
+
+void cpu_percpu_init(void)
+{
+    size_t size = (uintptr_t) &cpu_percpu_end - (uintptr_t) &cpu_percpu_begin;
+    cpu_id_t current = cpu_lapic_id();
+    size_t i;
+    
+    for (i = 0; i < cpu_count(); ++i) {
+        cpu_t *cpu = cpu_get_index(i);
+        
+        // Copy template into a cache line aligned area
+        uintptr_t area = mem_align(
+            (uintptr_t) malloc(size + CACHE_LINE_SIZE), CACHE_LINE_SIZE);
+        memcpy((void *) area, (void *) &cpu_percpu_template, size);
+        
+        // Fill in the CPU's fields
+        *((uintptr_t *) (area + PERCPU_OFFSET(cpu_percpu_self))) = area;
+        *((cpu_t **) (area + PERCPU_OFFSET(cpu_percpu_cpu))) = cpu;
+        *((cpu_id_t *) (area + PERCPU_OFFSET(cpu_percpu_id))) = cpu->id;
+        *((size_t *) (area + PERCPU_OFFSET(cpu_percpu_index))) = cpu->index;
+        cpu->percpu = area;
+    }
+    
+    // Switch BSP from the template to its own area
+    _cpu_percpu_set(cpu_get(current)->percpu);
+    
+    // Let RDTSCP return the BSP's logical number
+    cpu_tsc_load();
+}
+
+void cpu_percpu_load(void)
+{
+    _cpu_percpu_set(cpu_get(cpu_lapic_id())->percpu);
+}
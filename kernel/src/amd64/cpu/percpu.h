@@ -0,0 +1,129 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+#pragma once
+#include <api/types.h>
+#include <api/cpu.h>
+
+//----------------------------------------------------------------------------//
+// Per-CPU Data - Constants
+//----------------------------------------------------------------------------//
+
+/**
+ * MSRs holding the GS base in use and the one swapped in by <tt>swapgs</tt>.
+ */
+#define PERCPU_GS_BASE_MSR          0xC0000101
+#define PERCPU_KERNEL_GS_BASE_MSR   0xC0000102
+
+//----------------------------------------------------------------------------//
+// Per-CPU Data - Macros
+//----------------------------------------------------------------------------//
+
+/**
+ * Places a variable in the per-CPU data area; every CPU gets its own copy,
+ * initialized with the variable's initial value.
+ *
+ * Per-CPU variables must only be accessed through the macros below.
+ */
+#define PERCPU __attribute__((section(".percpu")))
+
+/**
+ * Offset of a per-CPU variable in the per-CPU data area.
+ *
+ * The <tt>.percpu</tt> section is linked at address 0, so the address of a
+ * per-CPU variable is its offset and resolves to a constant at link time.
+ */
+#define PERCPU_OFFSET(var) ((uintptr_t) &(var))
+
+/**
+ * The current CPU's copy of a per-CPU variable, addressed relative to GS.
+ */
+#define PERCPU_GS(var) (*((__seg_gs __typeof__(var) *) PERCPU_OFFSET(var)))
+
+/**
+ * Reads or writes the current CPU's copy of a per-CPU variable with a single
+ * GS relative access.
+ */
+#define percpu_read(var)            (PERCPU_GS(var))
+#define percpu_write(var, value)    (PERCPU_GS(var) = (value))
+
+/**
+ * Returns a regular pointer to the current CPU's copy of a per-CPU variable.
+ *
+ * Only valid as long as the thread stays on the CPU.
+ */
+#define percpu_ptr(var) \
+    ((__typeof__(var) *) (percpu_read(cpu_percpu_self) + PERCPU_OFFSET(var)))
+
+//----------------------------------------------------------------------------//
+// Per-CPU Data - Variables
+//----------------------------------------------------------------------------//
+
+/**
+ * Begin and end of the per-CPU data template (linker symbols, relative to
+ * the per-CPU data area).
+ */
+extern uint8_t cpu_percpu_begin;
+extern uint8_t cpu_percpu_end;
+
+/**
+ * Address the per-CPU data template has been loaded to (linker symbol).
+ */
+extern uint8_t cpu_percpu_template;
+
+/**
+ * Address of the current CPU's per-CPU data area.
+ */
+extern PERCPU uintptr_t cpu_percpu_self;
+
+/**
+ * The current CPU's structure and id.
+ */
+extern PERCPU cpu_t *cpu_percpu_cpu;
+extern PERCPU cpu_id_t cpu_percpu_id;
+
+/**
+ * The current CPU's logical number.
+ */
+extern PERCPU size_t cpu_percpu_index;
+
+//----------------------------------------------------------------------------//
+// Per-CPU Data
+//----------------------------------------------------------------------------//
+
+/**
+ * Points the BSP's GS base at the per-CPU data template, so per-CPU variables
+ * can be accessed before the data areas are allocated.
+ *
+ * Only to be called once on the BSP during early boot.
+ */
+void cpu_percpu_boot(void);
+
+/**
+ * Allocates the per-CPU data areas of all CPUs and loads the BSP's.
+ *
+ * Only to be called once on the BSP after all CPUs have been added.
+ */
+void cpu_percpu_init(void);
+
+/**
+ * Loads the per-CPU data area of the current CPU into its GS base.
+ *
+ * To be called on each AP during startup.
+ */
+void cpu_percpu_load(void);
@@ -16,15 +16,27 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
  
+ 
 #include <api/types.h>
+#include <api/cpu.h>
+#include <api/string.h>
 #include <api/cpu/timer.h>
+#include <api/cpu/ipi.h>
+#include <api/sync/spinlock.h>
+#include <api/util/time.h>
+#include <amd64/cpu.h>
 #include <amd64/cpu/timer.h>
+#include <amd64/cpu/features.h>
 #include <amd64/cpu/lapic.h>
 #include <amd64/cpu/pit.h>
+#include <amd64/cpu/hpet.h>
 #include <amd64/cpu/pic.h>
 #include <amd64/cpu/int.h>
+#include <amd64/util/time.h>
 #include <api/memory/heap.h>
 #include <api/cpu/int.h>
+#include <api/cpu/defer.h>
+#include <api/debug/console.h>
 
 //----------------------------------------------------------------------------//
 // Timer - Constants
@@ -38,16 +50,67 @@
 #define TIMER_INIT_FREQ                 1000
 
 /**
- * The timer's interval in microseconds.
+ * The period the LAPIC timer and the TSC are measured over when calibrating
+ * against the HPET (in nanoseconds).
+ *
+ * Ten milliseconds keep the error of the HPET and LAPIC reads at the window's
+ * ends, about a microsecond, in the order of 100 ppm.
+ */
+#define TIMER_CALIBRATE_NS              10000000ULL
+
+/**
+ * The length of a timer tick in microseconds and nanoseconds.
+ *
+ * Timers expire at tick boundaries in both LAPIC timer modes. In TSC-deadline
+ * mode the timer is armed with the exact TSC value of the tick the earliest
+ * timer is due at, so the resolution is one tick rather than a LAPIC count.
  */
 #define TIMER_INTERVAL                  100
+#define TIMER_INTERVAL_NS               (TIMER_INTERVAL * 1000ULL)
+
+/**
+ * Timer wheel geometry: <tt>TIMER_WHEEL_LEVELS</tt> levels of 64 slots, where
+ * a slot of level <tt>l</tt> covers <tt>64^l</tt> ticks.
+ */
+#define TIMER_WHEEL_BITS                6
+#define TIMER_WHEEL_SLOTS               (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK                (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS              4
+
+/**
+ * Largest distance in ticks a timer can be placed at; timers further away
+ * are placed at this distance and re-sorted when cascaded.
+ */
+#define TIMER_WHEEL_MAX_DELTA           ((1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1)
+
+/**
+ * Maximum time the LAPIC timer is armed ahead in counting mode (in
+ * milliseconds); timers further away take one early interrupt to re-arm.
+ */
+#define TIMER_MAX_ARM_MS                4000
+
+/**
+ * The MSR the LAPIC timer is armed with in TSC-deadline mode.
+ */
+#define TIMER_TSC_DEADLINE_MSR          0x6E0
+
+/**
+ * LVT timer modes (bits 17-18).
+ */
+#define TIMER_LVT_ONESHOT               (0 << 17)
+#define TIMER_LVT_TSC_DEADLINE          (2 << 17)
+
+/**
+ * Marks the absence of an expiry.
+ */
+#define TIMER_NEVER                     ((uint64_t) -1)
 
 //----------------------------------------------------------------------------//
 // Timer - Structures
 //----------------------------------------------------------------------------//
 
 /**
- * Structure for registered timer handlers.
+ * Structure for timer handlers registered on a CPU.
  */
 typedef struct cpu_timer_handler_t
 {
@@ -61,6 +124,11 @@ typedef struct cpu_timer_handler_t
      */
     uint32_t granularity;
     
+    /**
+     * The periodic timer calling the handler.
+     */
+    cpu_timer_t timer;
+    
     /**
      * Pointer to next handler structure.
      */
@@ -68,62 +136,529 @@ typedef struct cpu_timer_handler_t
     
 } cpu_timer_handler_t;
 
+/**
+ * A CPU's hierarchical timer wheel.
+ */
+typedef struct cpu_timer_wheel_t
+{
+    /**
+     * Slots per level: lists of pending timers.
+     */
+    cpu_timer_t *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    
+    /**
+     * Bitmaps of non-empty slots per level.
+     */
+    uint64_t occupied[TIMER_WHEEL_LEVELS];
+    
+    /**
+     * The first tick that has not been processed yet.
+     */
+    uint64_t now;
+    
+    /**
+     * The last tick higher levels have been cascaded at.
+     */
+    uint64_t cascaded;
+    
+    /**
+     * The tick the LAPIC timer is armed for or <tt>TIMER_NEVER</tt>.
+     */
+    uint64_t armed;
+    
+    /**
+     * The TSC value the LAPIC timer is armed with in TSC-deadline mode.
+     */
+    uint64_t armed_tsc;
+    
+    /**
+     * Wakeup statistics.
+     */
+    cpu_timer_stats_t stats;
+    
+    /**
+     * The timer whose callback is currently running or a null-pointer.
+     */
+    cpu_timer_t * volatile running;
+    
+    /**
+     * The timer handlers registered on the CPU.
+     */
+    cpu_timer_handler_t *handlers;
+    
+    /**
+     * Lock for the wheel and the handler list (taken with interrupts
+     * disabled).
+     */
+    spinlock_t lock;
+    
+} cpu_timer_wheel_t;
+
 //----------------------------------------------------------------------------//
 // Timer - Variables
 //----------------------------------------------------------------------------//
 
-/**
- * The current timer's ticks.
- */
-static uint64_t _cpu_timer_ticks = 0;
-
 /**
  * The current timer's initialization state.
  *
  * @see _cpu_timer_init_irq
  * @see _cpu_timer_init
  */
-static uint32_t _cpu_timer_stage = 0;
+static volatile uint32_t _cpu_timer_stage = 0;
 
 /**
  * The timer's multiplier.
  *
  * The number the LAPIC's timer will count in one millisecond.
  */
-static uint32_t _cpu_timer_multiplier = 0;
+static volatile uint32_t _cpu_timer_multiplier = 0;
 
 /**
- * A linked list of the registered timer handlers.
+ * TSC values at the first and second calibration IRQ.
  */
-static cpu_timer_handler_t *_cpu_timer_handlers = 0;
+static volatile uint64_t _cpu_timer_tsc_begin = 0;
+static volatile uint64_t _cpu_timer_tsc_end = 0;
+
+/**
+ * Whether the LAPIC timers run in TSC-deadline mode rather than counting
+ * down.
+ */
+static bool _cpu_timer_deadline = false;
+
+/**
+ * The timer wheels per CPU, indexed by the CPU's logical number.
+ */
+static cpu_timer_wheel_t *_cpu_timer_wheels[MAX_CPUS];
 
 //----------------------------------------------------------------------------//
-// Timer - Internal
+// Timer - Internal - Wheel
 //----------------------------------------------------------------------------//
 
 /**
- * The IRQ handler to use for the LAPIC timer.
+ * Returns the timer wheel of the given CPU.
+ *
+ * @param cpu The id of the CPU.
+ * @return The wheel or a null-pointer, if the CPU has none.
+ */
+static cpu_timer_wheel_t *_cpu_timer_wheel(cpu_id_t cpu)
+{
+    cpu_t *info = cpu_get(cpu);
+    return (0 != info) ? _cpu_timer_wheels[info->index] : 0;
+}
+
+/**
+ * Returns whether no timer is pending in the given wheel.
+ *
+ * @param wheel The wheel (locked).
+ * @return Whether the wheel is empty.
+ */
+static bool _cpu_timer_wheel_empty(cpu_timer_wheel_t *wheel)
+{
+    uint8_t level;
+    
+    for (level = 0; level < TIMER_WHEEL_LEVELS; ++level)
+        if (0 != wheel->occupied[level])
+            return false;
+            
+    return true;
+}
+
+/**
+ * Inserts a timer into the slot determined by its deadline.
+ *
+ * Deadlines in the past are placed in the next slot to be processed.
+ *
+ * @param wheel The wheel (locked).
+ * @param timer The timer.
+ */
+static void _cpu_timer_wheel_insert(cpu_timer_wheel_t *wheel, cpu_timer_t *timer)
+{
+    uint64_t expires = timer->deadline;
+    
+    // Clamp into the range of the wheel
+    if (expires < wheel->now)
+        expires = wheel->now;
+    else if (expires - wheel->now > TIMER_WHEEL_MAX_DELTA)
+        expires = wheel->now + TIMER_WHEEL_MAX_DELTA;
+        
+    // Find level: the first one whose range covers the distance
+    uint64_t delta = expires - wheel->now;
+    uint8_t level = 0;
+    
+    while (level < TIMER_WHEEL_LEVELS - 1 &&
+           delta >= (1ULL << (TIMER_WHEEL_BITS * (level + 1))))
+        ++level;
+        
+    uint8_t slot = (expires >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+    
+    // Link at slot head
+    cpu_timer_t **head = &wheel->slots[level][slot];
+    
+    timer->level = level;
+    timer->slot = slot;
+    timer->prev = 0;
+    timer->next = *head;
+    
+    if (0 != *head)
+        (*head)->prev = timer;
+        
+    *head = timer;
+    wheel->occupied[level] |= 1ULL << slot;
+}
+
+/**
+ * Removes a timer from its slot.
+ *
+ * @param wheel The wheel (locked).
+ * @param timer The timer.
+ */
+static void _cpu_timer_wheel_remove(cpu_timer_wheel_t *wheel, cpu_timer_t *timer)
+{
+    cpu_timer_t **head = &wheel->slots[timer->level][timer->slot];
+    
+    if (0 != timer->prev)
+        timer->prev->next = timer->next;
+    else
+        *head = timer->next;
+        
+    if (0 != timer->next)
+        timer->next->prev = timer->prev;
+        
+    if (0 == *head)
+        wheel->occupied[timer->level] &= ~(1ULL << timer->slot);
+        
+    timer->next = timer->prev = 0;
+}
+
+/**
+ * Re-sorts the timers of the higher level slots that are reached at the
+ * current tick into lower levels.
+ *
+ * @param wheel The wheel (locked), with <tt>now</tt> on a level 0 boundary.
+ */
+static void _cpu_timer_wheel_cascade(cpu_timer_wheel_t *wheel)
+{
+    uint8_t level;
+    
+    for (level = 1; level < TIMER_WHEEL_LEVELS; ++level) {
+        uint8_t slot = (wheel->now >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+        
+        // Detach and re-insert the slot's timers
+        cpu_timer_t *timer = wheel->slots[level][slot];
+        wheel->slots[level][slot] = 0;
+        wheel->occupied[level] &= ~(1ULL << slot);
+        
+        while (0 != timer) {
+            cpu_timer_t *next = timer->next;
+            _cpu_timer_wheel_insert(wheel, timer);
+            timer = next;
+        }
+        
+        // Higher level boundary not reached?
+        if (0 != slot)
+            break;
+    }
+}
+
+/**
+ * Determines the tick the wheel has to be processed at next.
+ *
+ * For higher levels this is the tick the next non-empty slot is cascaded at,
+ * which may be earlier than the expiry of its timers.
+ *
+ * @param wheel The wheel (locked).
+ * @return The next tick or <tt>TIMER_NEVER</tt>, if no timer is pending.
  */
-static void *_cpu_timer_irq(uint8_t vector, void *ctx)
+static uint64_t _cpu_timer_wheel_next(cpu_timer_wheel_t *wheel)
 {
-    // Increase tick count
-    ++_cpu_timer_ticks;
+    uint64_t next = TIMER_NEVER;
+    uint8_t level;
     
-    // Iterate over handlers
-    cpu_timer_handler_t *current = _cpu_timer_handlers;
-    while (0 != current) {
-        // Check granularity
-        if (0 == _cpu_timer_ticks % current->granularity)
-            current->callback(_cpu_timer_ticks, ctx);
+    for (level = 0; level < TIMER_WHEEL_LEVELS; ++level) {
+        uint64_t bits = wheel->occupied[level];
+        
+        if (0 == bits)
+            continue;
+            
+        uint8_t shift = TIMER_WHEEL_BITS * level;
+        uint64_t pos = wheel->now >> shift;
+        uint8_t current = pos & TIMER_WHEEL_MASK;
+        
+        // Current slot is still due, unless its boundary has been passed
+        uint8_t first = (0 == (wheel->now & ((1ULL << shift) - 1))) ? current : current + 1;
+        uint64_t later = (first > TIMER_WHEEL_MASK) ? 0 : bits & (~0ULL << first);
+        uint64_t base = pos & ~((uint64_t) TIMER_WHEEL_MASK);
+        uint64_t tick = (0 != later)
+            ? (base + __builtin_ctzll(later)) << shift
+            : (base + TIMER_WHEEL_SLOTS + __builtin_ctzll(bits)) << shift;
+            
+        if (tick < next)
+            next = tick;
+    }
+    
+    return (next < wheel->now) ? wheel->now : next;
+}
+
+/**
+ * Advances the wheel up to (including) the given tick and removes the first
+ * timer that is due.
+ *
+ * Skips ticks at which neither a timer expires nor a slot is cascaded, so
+ * long idle periods cost only a few steps.
+ *
+ * @param wheel The wheel (locked).
+ * @param current The current tick.
+ * @return The first due timer or a null-pointer, if none is due.
+ */
+static cpu_timer_t *_cpu_timer_wheel_advance(cpu_timer_wheel_t *wheel, uint64_t current)
+{
+    while (wheel->now <= current) {
+        uint8_t slot = wheel->now & TIMER_WHEEL_MASK;
+        
+        // Cascade on level boundary (once, before the slot is processed)
+        if (0 == slot && wheel->cascaded != wheel->now) {
+            _cpu_timer_wheel_cascade(wheel);
+            wheel->cascaded = wheel->now;
+        }
+            
+        // Due timer in current slot?
+        cpu_timer_t *timer = wheel->slots[0][slot];
+        
+        if (0 != timer) {
+            _cpu_timer_wheel_remove(wheel, timer);
+            
+            // Not yet due (placed at the end of the wheel's range)?
+            if (timer->deadline > current) {
+                _cpu_timer_wheel_insert(wheel, timer);
+                continue;
+            }
+            
+            return timer;
+        }
+        
+        // Skip to the next tick the wheel has to be processed at
+        ++wheel->now;
+        
+        uint64_t next = _cpu_timer_wheel_next(wheel);
+        
+        if (next > current + 1)
+            next = current + 1;
+            
+        if (next > wheel->now)
+            wheel->now = next;
+    }
+    
+    return 0;
+}
+
+/**
+ * Removes a timer from the level 0 slots whose expiry has already passed,
+ * although its deadline has not, so it can share the current interrupt.
+ *
+ * @param wheel The wheel (locked).
+ * @param current The current tick.
+ * @return The timer or a null-pointer, if there is none.
+ */
+static cpu_timer_t *_cpu_timer_wheel_early(cpu_timer_wheel_t *wheel, uint64_t current)
+{
+    uint64_t bits = wheel->occupied[0];
+    
+    while (0 != bits) {
+        uint8_t slot = __builtin_ctzll(bits);
+        bits &= bits - 1;
+        
+        cpu_timer_t *timer;
+        
+        for (timer = wheel->slots[0][slot]; 0 != timer; timer = timer->next)
+            if (timer->expires <= current) {
+                _cpu_timer_wheel_remove(wheel, timer);
+                return timer;
+            }
+    }
+    
+    return 0;
+}
+
+/**
+ * Determines the deadline of a timer within its slack window.
+ *
+ * Rounds the latest allowed tick down to the coarsest power of two boundary
+ * inside the window, so timers with overlapping windows tend to share a
+ * deadline and thereby an interrupt.
+ *
+ * @param expires The expiry.
+ * @param slack The slack.
+ * @return The deadline.
+ */
+static uint64_t _cpu_timer_coalesce(uint64_t expires, uint64_t slack)
+{
+    uint64_t limit = expires + slack;
+    
+    if (0 == slack || limit < expires)
+        return expires;
+        
+    // Clear all bits below the highest one that differs
+    uint64_t mask = (1ULL << (63 - __builtin_clzll(limit ^ expires))) - 1;
+    return limit & ~mask;
+}
+
+//----------------------------------------------------------------------------//
+// Timer - Internal - Hardware
+//----------------------------------------------------------------------------//
+
+/**
+ * Arms the current CPU's LAPIC timer for the next expiry of its wheel, or
+ * stops it if no timer is pending.
+ *
+ * @param wheel The current CPU's wheel (locked).
+ */
+static void _cpu_timer_program(cpu_timer_wheel_t *wheel)
+{
+    uint64_t next = _cpu_timer_wheel_next(wheel);
+    wheel->armed = next;
+    
+    // TSC-deadline mode: arm with the absolute TSC value (0 disarms)
+    if (_cpu_timer_deadline) {
+        uint64_t tsc = (TIMER_NEVER == next)
+            ? 0
+            : time_ns_to_tsc(next * TIMER_INTERVAL_NS);
+            
+        if (0 == tsc && TIMER_NEVER != next)
+            tsc = 1;
             
-        // Next
-        current = current->next;
+        wheel->armed_tsc = tsc;
+        cpu_msr_write(TIMER_TSC_DEADLINE_MSR, tsc);
+        return;
     }
     
+    // Nothing pending: no interrupts at all
+    if (TIMER_NEVER == next) {
+        cpu_lapic_write(LAPIC_INIT_COUNT_OFFSET, 0);
+        return;
+    }
+    
+    // Convert distance to LAPIC counts (at most a few seconds ahead)
+    uint64_t target = next * TIMER_INTERVAL_NS;
+    uint64_t now = time_monotonic_ns();
+    uint64_t delta = (target > now) ? target - now : 0;
+    
+    if (delta > TIMER_MAX_ARM_MS * 1000000ULL)
+        delta = TIMER_MAX_ARM_MS * 1000000ULL;
+        
+    uint64_t count = (delta * _cpu_timer_multiplier) / 1000000;
+    
+    if (0 == count)
+        count = 1;
+    else if (count > 0xFFFFFFFF)
+        count = 0xFFFFFFFF;
+        
+    cpu_lapic_write(LAPIC_INIT_COUNT_OFFSET, (uint32_t) count);
+}
+
+//----------------------------------------------------------------------------//
+// Timer - Internal - Handling
+//----------------------------------------------------------------------------//
+
+/**
+ * Runs the due timers of the current CPU and re-arms the LAPIC timer.
+ *
+ * Deferred by the timer IRQ, so the callbacks run with interrupts enabled and
+ * without the wheel being locked.
+ *
+ * @param arg Unused.
+ */
+static void _cpu_timer_expire(void *arg)
+{
+    cpu_timer_wheel_t *wheel = _cpu_timer_wheels[cpu_current_index()];
+    bool woken = false;
+    
+    if (0 == wheel)
+        return;
+        
+    while (1) {
+        spinlock_acquire(&wheel->lock);
+        
+        uint64_t current = cpu_timer_ticks();
+        
+        // The armed tick has been reached once its TSC deadline has passed,
+        // even if converting the TSC back to ticks rounded down
+        if (_cpu_timer_deadline && TIMER_NEVER != wheel->armed &&
+            current < wheel->armed && cpu_tsc_read() >= wheel->armed_tsc)
+            current = wheel->armed;
+            
+        cpu_timer_t *timer = _cpu_timer_wheel_advance(wheel, current);
+        
+        // Run timers within their slack window along with the due ones
+        if (0 == timer && woken)
+            timer = _cpu_timer_wheel_early(wheel, current);
+            
+        // Nothing due anymore: re-arm
+        if (0 == timer) {
+            _cpu_timer_program(wheel);
+            spinlock_release(&wheel->lock);
+            break;
+        }
+        
+        // Re-insert periodic timers, one-shot timers are done
+        timer_callback_t callback = timer->callback;
+        void *callback_arg = timer->arg;
+        
+        if (0 != timer->period) {
+            timer->expires += timer->period;
+            
+            // Skip missed periods
+            if (timer->expires < wheel->now)
+                timer->expires = wheel->now;
+                
+            timer->deadline = _cpu_timer_coalesce(timer->expires, timer->slack);
+            _cpu_timer_wheel_insert(wheel, timer);
+        } else
+            timer->pending = false;
+            
+        // Statistics
+        ++wheel->stats.expired;
+        
+        if (woken)
+            ++wheel->stats.coalesced;
+        else
+            ++wheel->stats.wakeups;
+            
+        woken = true;
+        
+        wheel->running = timer;
+        spinlock_release(&wheel->lock);
+        
+        callback(callback_arg);
+        wheel->running = 0;
+    }
+}
+
+/**
+ * The IRQ handler to use for the LAPIC timer.
+ *
+ * Also used as IPI to make a CPU re-arm its timer.
+ *
+ * @param vector The interrupt vector.
+ */
+static void _cpu_timer_irq(interrupt_vector_t vector)
+{
     // EOI
     cpu_lapic_eoi();
     
-    return ctx;
+    // Run timers after the IRQ (or right now, if they can not be deferred)
+    if (!cpu_defer(&_cpu_timer_expire, 0))
+        _cpu_timer_expire(0);
+}
+
+/**
+ * Calls a legacy timer handler.
+ *
+ * @param arg The handler structure.
+ */
+static void _cpu_timer_handler_call(void *arg)
+{
+    cpu_timer_handler_t *handler = (cpu_timer_handler_t *) arg;
+    handler->callback(cpu_timer_ticks(), 0);
 }
 
 /**
@@ -131,12 +666,12 @@ static void *_cpu_timer_irq(uint8_t vector, void *ctx)
  *
  * On the first call, the LAPIC Timer is initialized at a known count, on the
  * second the difference between the current and the initial LAPIC Timer count
- * is calculated and used as the timer multiplier.
+ * is calculated and used as the timer multiplier. The TSC is sampled at the
+ * same points.
  *
  * @param vector The interrupt vector.
- * @param ctx The interrupt context.
  */
-static void *_cpu_timer_init_irq(uint8_t vector, void *ctx)
+static void _cpu_timer_init_irq(interrupt_vector_t vector)
 {
     // Increase stage number
     ++_cpu_timer_stage;
@@ -144,12 +679,14 @@ static void *_cpu_timer_init_irq(uint8_t vector, void *ctx)
     // First timer IRQ?
     if (1 == _cpu_timer_stage) {
         // Set Initial Count Register to maximum 32 bit integer value
-        *LAPIC_REGISTER(LAPIC_INIT_COUNT_OFFSET) = 0xFFFFFFFF;
+        cpu_lapic_write(LAPIC_INIT_COUNT_OFFSET, 0xFFFFFFFF);
+        _cpu_timer_tsc_begin = cpu_tsc_read();
         
     // Second timer IRQ?
     } else if (2 == _cpu_timer_stage) {
         // Save Current Count Register's value
-        uint32_t current = *LAPIC_REGISTER(LAPIC_CURRENT_COUNT_OFFSET);
+        uint32_t current = cpu_lapic_read(LAPIC_CURRENT_COUNT_OFFSET);
+        _cpu_timer_tsc_end = cpu_tsc_read();
         
         // Calculate difference, i.e. the LAPIC counter ticks per milli second
         _cpu_timer_multiplier = 0xFFFFFFFF - current;
@@ -157,50 +694,338 @@ static void *_cpu_timer_init_irq(uint8_t vector, void *ctx)
     
     // Send EOI to PIC
     cpu_pic_eoi(0);
+}
+
+/**
+ * Calibrates the LAPIC timer and the TSC using the PIT.
+ *
+ * Waits for two PIT IRQs one millisecond apart.
+ *
+ * @return The measured TSC frequency in Hz.
+ */
+static uint64_t _cpu_timer_calibrate_pit(void)
+{
+    // Set PIT frequency
+    cpu_pit_freq_set(TIMER_INIT_FREQ);
+
+    // Register handler for PIT's IRQ
+    cpu_int_register_irq(INT_PIC_IRQ_OFFSET, &_cpu_timer_init_irq);
+
+    // Enable PIT
+    cpu_pit_enable();
+
+    // Wait for timer calibration to complete
+    while (3 > _cpu_timer_stage);
+
+    // Disable PIT
+    cpu_pit_disable();
+    
+    return (_cpu_timer_tsc_end - _cpu_timer_tsc_begin) * TIMER_INIT_FREQ;
+}
+
+/**
+ * Calibrates the LAPIC timer and the TSC using the HPET.
+ *
+ * Polls the HPET's main counter for <tt>TIMER_CALIBRATE_NS</tt> with
+ * interrupts disabled; no IRQ latency enters the measurement.
+ *
+ * @return The measured TSC frequency in Hz.
+ */
+static uint64_t _cpu_timer_calibrate_hpet(void)
+{
+    bool interruptable = cpu_is_interruptable();
+    cpu_set_interruptable(false);
+    
+    // Start LAPIC timer at a known count and take the reference samples
+    cpu_lapic_write(LAPIC_INIT_COUNT_OFFSET, 0xFFFFFFFF);
+    uint64_t tsc_begin = cpu_tsc_read_ordered();
+    uint64_t begin = cpu_hpet_read();
+    
+    // Wait for the calibration period
+    while (cpu_hpet_elapsed_ns(begin) < TIMER_CALIBRATE_NS)
+        asm volatile ("pause");
+        
+    // Sample in reverse order, so the access latencies cancel out
+    uint64_t elapsed = cpu_hpet_elapsed_ns(begin);
+    uint64_t tsc_end = cpu_tsc_read_ordered();
+    uint32_t current = cpu_lapic_read(LAPIC_CURRENT_COUNT_OFFSET);
+    
+    if (interruptable)
+        cpu_set_interruptable(true);
+        
+    // LAPIC counts per millisecond
+    _cpu_timer_multiplier = ((uint64_t) (0xFFFFFFFF - current) * 1000000) / elapsed;
+    
+    console_debug("[TIME] Calibrated against HPET over ");
+    console_debug_dec(elapsed);
+    console_debug(" ns\n");
+    
+    return ((tsc_end - tsc_begin) * 1000000000ULL) / elapsed;
+}
+
+#ifdef __BENCHMARK__
+/**
+ * Calibrates using both the PIT and the HPET and reports the TSC frequency
+ * and the time taken by each, as well as the PIT's deviation from the HPET.
+ *
+ * @return The TSC frequency in Hz measured against the HPET.
+ */
+static uint64_t _cpu_timer_calibrate_compare(void)
+{
+    uint64_t begin = cpu_tsc_read_ordered();
+    uint64_t pit_hz = _cpu_timer_calibrate_pit();
+    uint64_t pit_cycles = cpu_tsc_read_ordered() - begin;
+    
+    begin = cpu_tsc_read_ordered();
+    uint64_t hpet_hz = _cpu_timer_calibrate_hpet();
+    uint64_t hpet_cycles = cpu_tsc_read_ordered() - begin;
+    
+    int64_t error_ppm = (((int64_t) pit_hz - (int64_t) hpet_hz) * 1000000) / (int64_t) hpet_hz;
+    
+    console_print("[BNCH] TSC calibration: PIT ");
+    console_print_dec((intptr_t) pit_hz);
+    console_print(" Hz in ");
+    console_print_dec((intptr_t) (pit_cycles * 1000000 / hpet_hz));
+    console_print(" us, HPET ");
+    console_print_dec((intptr_t) hpet_hz);
+    console_print(" Hz in ");
+    console_print_dec((intptr_t) (hpet_cycles * 1000000 / hpet_hz));
+    console_print(" us, PIT error ");
+    console_print_dec((intptr_t) error_ppm);
+    console_print(" ppm\n");
+    
+    return hpet_hz;
+}
+#endif
+
+//----------------------------------------------------------------------------//
+// Timer - One-shot Timers
+//----------------------------------------------------------------------------//
+
+void cpu_timer_setup(cpu_timer_t *timer, timer_callback_t callback, void *arg)
+{
+    memset(timer, 0, sizeof(cpu_timer_t));
+    timer->callback = callback;
+    timer->arg = arg;
+}
+
+void cpu_timer_set_slack(cpu_timer_t *timer, uint64_t slack)
+{
+    timer->slack = slack;
+}
+
+void cpu_timer_start(cpu_timer_t *timer, uint64_t expires, uint64_t period)
+{
+    // Pin to the current CPU while arming
+    bool interruptable = cpu_is_interruptable();
+    cpu_set_interruptable(false);
+    
+    cpu_timer_start_on(timer, expires, period, cpu_current_id());
+    
+    if (interruptable)
+        cpu_set_interruptable(true);
+}
+
+bool cpu_timer_start_on(
+    cpu_timer_t *timer, uint64_t expires, uint64_t period, cpu_id_t cpu)
+{
+    cpu_timer_wheel_t *wheel = _cpu_timer_wheel(cpu);
+    
+    if (0 == wheel)
+        return false;
+        
+    // Disarm first (possibly on another CPU)
+    cpu_timer_cancel(timer);
+    
+    spinlock_acquire(&wheel->lock);
+    
+    // Empty wheel: skip the idle period right away
+    uint64_t current = cpu_timer_ticks();
+    
+    if (_cpu_timer_wheel_empty(wheel) && wheel->now < current)
+        wheel->now = current;
+        
+    timer->expires = expires;
+    timer->deadline = _cpu_timer_coalesce(expires, timer->slack);
+    timer->period = period;
+    timer->cpu = cpu;
+    timer->pending = true;
+    _cpu_timer_wheel_insert(wheel, timer);
+    
+    // New earliest expiry?
+    bool earlier = (_cpu_timer_wheel_next(wheel) < wheel->armed);
+    bool local = (cpu == cpu_current_id());
+    
+    if (earlier && local)
+        _cpu_timer_program(wheel);
+        
+    spinlock_release(&wheel->lock);
+    
+    // Make remote CPU re-arm its timer
+    if (earlier && !local)
+        cpu_ipi_single(INT_VECTOR_TIMER, cpu);
+        
+    return true;
+}
+
+bool cpu_timer_cancel_sync(cpu_timer_t *timer)
+{
+    bool pending = cpu_timer_cancel(timer);
+    cpu_timer_wheel_t *wheel = _cpu_timer_wheel(timer->cpu);
     
-    return ctx;
+    // Wait for a running callback to return
+    if (0 != wheel)
+        while (wheel->running == timer)
+            asm volatile ("pause");
+            
+    return pending;
+}
+
+bool cpu_timer_cancel(cpu_timer_t *timer)
+{
+    if (!timer->pending)
+        return false;
+        
+    cpu_timer_wheel_t *wheel = _cpu_timer_wheel(timer->cpu);
+    bool pending;
+    
+    spinlock_acquire(&wheel->lock);
+    
+    // Still pending after locking?
+    pending = timer->pending;
+    
+    if (pending) {
+        _cpu_timer_wheel_remove(wheel, timer);
+        timer->pending = false;
+    }
+    
+    // The LAPIC timer is left armed; an early interrupt only re-arms it
+    spinlock_release(&wheel->lock);
+    
+    return pending;
 }
 
 //----------------------------------------------------------------------------//
 // Timer - Handling
 //----------------------------------------------------------------------------//
 
-void cpu_timer_register(timer_handler_t handler, uint32_t granularity)
+bool cpu_timer_register_on(
+    timer_handler_t handler, uint32_t granularity, uint32_t slack, cpu_id_t cpu)
 {
+    cpu_timer_wheel_t *wheel = _cpu_timer_wheel(cpu);
+    
+    if (0 == wheel || 0 == granularity)
+        return false;
+        
     // Create new handler structure
     cpu_timer_handler_t *_handler = malloc(sizeof(cpu_timer_handler_t));
     
     _handler->callback = handler;
     _handler->granularity = granularity;
-    _handler->next = _cpu_timer_handlers;
+    cpu_timer_setup(&_handler->timer, &_cpu_timer_handler_call, _handler);
+    cpu_timer_set_slack(&_handler->timer, slack);
     
-    // Insert into list
-    _cpu_timer_handlers = _handler;
+    // Insert into the CPU's list
+    spinlock_acquire(&wheel->lock);
+    _handler->next = wheel->handlers;
+    wheel->handlers = _handler;
+    spinlock_release(&wheel->lock);
+    
+    // Start periodic timer, aligned to multiples of the granularity
+    uint64_t expires = (cpu_timer_ticks() / granularity + 1) * granularity;
+    cpu_timer_start_on(&_handler->timer, expires, granularity, cpu);
+    
+    return true;
+}
+
+void cpu_timer_register(
+    timer_handler_t handler, uint32_t granularity, uint32_t slack)
+{
+    size_t i;
+    
+    for (i = 0; i < cpu_count(); ++i) {
+        cpu_t *cpu = cpu_get_index(i);
+        
+        if (cpu->flags & CPU_FLAG_INIT)
+            cpu_timer_register_on(handler, granularity, slack, cpu->id);
+    }
+}
+
+void cpu_timer_unregister_on(timer_handler_t handler, cpu_id_t cpu)
+{
+    cpu_timer_wheel_t *wheel = _cpu_timer_wheel(cpu);
+    
+    if (0 == wheel)
+        return;
+        
+    // Remove from the CPU's list
+    spinlock_acquire(&wheel->lock);
+    
+    cpu_timer_handler_t **link = &wheel->handlers;
+    cpu_timer_handler_t *current;
+    
+    while (0 != (current = *link) && current->callback != handler)
+        link = &current->next;
+        
+    if (0 != current)
+        *link = current->next;
+        
+    spinlock_release(&wheel->lock);
+    
+    if (0 == current)
+        return;
+        
+    // Stop timer, waiting for a running call, and free memory
+    cpu_timer_cancel_sync(&current->timer);
+    free(current);
 }
 
 void cpu_timer_unregister(timer_handler_t handler)
 {
-    // Iterate over handlers
-    cpu_timer_handler_t *current = _cpu_timer_handlers;
-    cpu_timer_handler_t *previous = 0;
+    size_t i;
     
-    while (0 != current) {
-        // Matches given handler callback?
-        if (current->callback != handler) {
-            current = current->next;
+    for (i = 0; i < cpu_count(); ++i)
+        cpu_timer_unregister_on(handler, cpu_get_index(i)->id);
+}
+
+//----------------------------------------------------------------------------//
+// Timer - Statistics
+//----------------------------------------------------------------------------//
+
+bool cpu_timer_stats(cpu_id_t cpu, cpu_timer_stats_t *stats)
+{
+    cpu_timer_wheel_t *wheel = _cpu_timer_wheel(cpu);
+    
+    if (0 == wheel)
+        return false;
+        
+    spinlock_acquire(&wheel->lock);
+    memcpy(stats, &wheel->stats, sizeof(cpu_timer_stats_t));
+    spinlock_release(&wheel->lock);
+    
+    return true;
+}
+
+void cpu_timer_stats_dump(void)
+{
+    cpu_timer_stats_t stats;
+    size_t i;
+    
+    for (i = 0; i < cpu_count(); ++i) {
+        cpu_t *cpu = cpu_get_index(i);
+        
+        if (!cpu_timer_stats(cpu->id, &stats))
             continue;
-        }
             
-        // Remove from list
-        if (0 == previous)
-            _cpu_timer_handlers = current->next;
-        else
-            previous->next = current->next;
-            
-        // Free memory
-        free(current);
-        
-        break;
+        console_print("[TIME] CPU ");
+        console_print_hex(cpu->id);
+        console_print(": ");
+        console_print_dec((intptr_t) stats.expired);
+        console_print(" timers in ");
+        console_print_dec((intptr_t) stats.wakeups);
+        console_print(" wakeups, ");
+        console_print_dec((intptr_t) stats.coalesced);
+        console_print(" saved\n");
     }
 }
 
@@ -211,37 +1036,62 @@ void cpu_timer_unregister(timer_handler_t handler)
 void cpu_timer_init(bool calibrate)
 {
     // Set LAPIC timer's Divide Configuration to a divisor of 1
-    *LAPIC_REGISTER(LAPIC_DCR_OFFSET) = 0xB;
+    cpu_lapic_write(LAPIC_DCR_OFFSET, 0xB);
 
     // Calibrate?
     if (calibrate) {
-        // Set PIT frequency
-        cpu_pit_freq_set(TIMER_INIT_FREQ);
-    
-        // Register handler for PIT's IRQ
-        cpu_int_register(INT_PIC_IRQ_OFFSET, &_cpu_timer_init_irq);
-    
-        // Enable PIT
-        cpu_pit_enable();
+        // Measure against the HPET, if present, and the PIT otherwise
+#ifdef __BENCHMARK__
+        uint64_t tsc_hz = cpu_hpet_present()
+            ? _cpu_timer_calibrate_compare()
+            : _cpu_timer_calibrate_pit();
+#else
+        uint64_t tsc_hz = cpu_hpet_present()
+            ? _cpu_timer_calibrate_hpet()
+            : _cpu_timer_calibrate_pit();
+#endif
+        
+        // TSC frequency (ticks are derived from the TSC clocksource)
+        cpu_tsc_calibrate(tsc_hz);
+            
+        // Arm with absolute TSC values, if supported
+        _cpu_timer_deadline = cpu_feature_present(CPU_FEATURE_TSC_DEADLINE);
+            
+        // Allocate timer wheels
+        size_t i;
+        
+        for (i = 0; i < cpu_count(); ++i) {
+            cpu_timer_wheel_t *wheel = malloc(sizeof(cpu_timer_wheel_t));
+            memset(wheel, 0, sizeof(cpu_timer_wheel_t));
+            wheel->armed = TIMER_NEVER;
+            wheel->cascaded = TIMER_NEVER;
+            _cpu_timer_wheels[i] = wheel;
+        }
+    }
     
-        // Wait for timer calibration to complete
-        while (3 > _cpu_timer_stage);
+    // Register interrupt handler
+    cpu_int_register_irq(INT_VECTOR_TIMER, &_cpu_timer_irq);
     
-        // Disable PIT
-        cpu_pit_disable();
+    // One-shot or TSC-deadline mode, not started until a timer is armed
+    cpu_lapic_write(LAPIC_INIT_COUNT_OFFSET, 0);
+    cpu_lapic_write(
+        LAPIC_LVT_OFFSET,
+        (INT_VECTOR_TIMER & 0xFF) |         // 0-7      (Vector)
+        (_cpu_timer_deadline                // 17-18    (Timer Mode)
+            ? TIMER_LVT_TSC_DEADLINE
+            : TIMER_LVT_ONESHOT));
+            
+    // Order the LVT write before the first deadline MSR write
+    if (_cpu_timer_deadline) {
+        asm volatile ("mfence" ::: "memory");
+        cpu_msr_write(TIMER_TSC_DEADLINE_MSR, 0);
     }
     
-    // Configure timer interval
-    *LAPIC_REGISTER(LAPIC_INIT_COUNT_OFFSET) =
-         (TIMER_INTERVAL * _cpu_timer_multiplier) / 1000;
-
-    // Interrupt Vector
-    *LAPIC_REGISTER(LAPIC_LVT_OFFSET) =
-        (INT_VECTOR_TIMER & 0xFF) |         // 0-7      (Vector)
-        (1 << 17);                          // 17       (Timer Mode: Periodic)
-        
-    // Register interrupt handler
-    cpu_int_register(INT_VECTOR_TIMER, &_cpu_timer_irq);
+    // Catch up with the current tick
+    cpu_timer_wheel_t *wheel = _cpu_timer_wheels[cpu_current_index()];
+    
+    if (0 != wheel)
+        wheel->now = cpu_timer_ticks();
 }
 
 uint32_t cpu_timer_interval(void)
@@ -251,5 +1101,5 @@ uint32_t cpu_timer_interval(void)
 
 uint64_t cpu_timer_ticks(void)
 {
-    return _cpu_timer_ticks;
+    return time_monotonic_ns() / TIMER_INTERVAL_NS;
 }
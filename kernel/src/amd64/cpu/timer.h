@@ -24,9 +24,17 @@
 //----------------------------------------------------------------------------//
 
 /**
- * Initializes the LAPIC timer.
+ * Initializes the LAPIC timer in one-shot mode.
  *
- * Makes the following assumptions about the system's state for calibration:
+ * The timer is only armed for the next expiry of the CPU's timer wheel, so a
+ * CPU without pending timers takes no timer interrupts. Uses TSC-deadline
+ * mode where supported and counts down otherwise. On calibration, the
+ * TSC frequency is determined as well and the timer wheels of all CPUs are
+ * allocated.
+ *
+ * Calibration measures against the HPET, if present, and falls back to the
+ * PIT otherwise. Makes the following assumptions about the system's state for
+ * calibration:
  *  * The PIC is enabled.
  *  * IRQs are enabled.
  *  * The current CPU's LAPIC is enabled.
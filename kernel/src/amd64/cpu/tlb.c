@@ -0,0 +1,143 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+
+#include <api/types.h>
+#include <api/compiler.h>
+#include <api/cpu.h>
+
+#include <api/cpu/int.h>
+
+#include <amd64/cpu.h>
+#include <amd64/cpu/int.h>
+#include <amd64/cpu/ipi.h>
+#include <amd64/cpu/lapic.h>
+#include <amd64/cpu/tlb.h>
+
+//----------------------------------------------------------------------------//
+// TLB - Variables
+//----------------------------------------------------------------------------//
+
+/**
+ * Number of shootdowns requested so far.
+ */
+static volatile uint64_t _cpu_tlb_generation = 0;
+
+/**
+ * The last shootdown each CPU has flushed its TLB for, indexed by the CPU's
+ * logical number.
+ */
+static volatile uint64_t _cpu_tlb_flushed[MAX_CPUS];
+
+/**
+ * Whether the IPI handler has been registered.
+ */
+static bool _cpu_tlb_ready = false;
+
+//----------------------------------------------------------------------------//
+// TLB - Internal
+//----------------------------------------------------------------------------//
+
+/**
+ * Flushes the current CPU's TLB, including global entries, and records the
+ * shootdowns covered by it.
+ */
+static void _cpu_tlb_flush(void)
+{
+    // Changes made before this generation are covered by the flush
+    uint64_t generation = _cpu_tlb_generation;
+    size_t index = cpu_current_index();
+    
+    // Toggling PGE flushes global entries as well, reloading CR3 does not
+    uintptr_t cr4 = cpu_get_cr4();
+    
+    if (cr4 & TLB_CR4_PGE) {
+        cpu_set_cr4(cr4 & ~TLB_CR4_PGE);
+        cpu_set_cr4(cr4);
+    } else
+        cpu_set_cr3(cpu_get_cr3());
+        
+    if (generation > _cpu_tlb_flushed[index])
+        _cpu_tlb_flushed[index] = generation;
+}
+
+/**
+ * IRQ handler of the shootdown IPI.
+ *
+ * @param vector The interrupt vector.
+ */
+static void _cpu_tlb_irq(interrupt_vector_t vector)
+{
+    _cpu_tlb_flush();
+    cpu_lapic_eoi();
+}
+
+//----------------------------------------------------------------------------//
+// TLB
+//----------------------------------------------------------------------------//
+
+void cpu_tlb_init(void)
+{
+    cpu_int_register_irq(INT_VECTOR_TLB, &_cpu_tlb_irq);
+    _cpu_tlb_ready = true;
+}
+
+void cpu_tlb_shootdown(void)
+{
+    // No other CPUs yet?
+    if (!_cpu_tlb_ready || cpu_count() < 2)
+        return;
+        
+    // Stay on this CPU while waiting
+    bool interruptable = cpu_is_interruptable();
+    cpu_set_interruptable(false);
+    
+    uint64_t target = __sync_add_and_fetch(&_cpu_tlb_generation, 1);
+    size_t self = cpu_current_index();
+    size_t i;
+    
+    cpu_ipi(
+        INT_VECTOR_TLB,             // Vector
+        0,                          // Destination
+        IPI_DEST_ALL_EX_SELF,       // Destination shorthand
+        IPI_MODE_PHYSICAL,          // Destination mode
+        IPI_DELIVERY_FIXED,         // Delivery mode
+        IPI_LEVEL_ASSERT,           // Level
+        cpu_current());             // Current CPU
+        
+    // Wait for all started CPUs, flushing for concurrent shootdowns meanwhile
+    for (i = 0; i < cpu_count(); ++i) {
+        if (i == self || !(((volatile cpu_t *) cpu_get_index(i))->flags & CPU_FLAG_INIT))
+            continue;
+            
+        while (_cpu_tlb_flushed[i] < target) {
+            cpu_tlb_poll();
+            asm volatile ("pause");
+        }
+    }
+    
+    // Restore interrupt state
+    if (interruptable)
+        cpu_set_interruptable(true);
+}
+
+void cpu_tlb_poll(void)
+{
+    if (_cpu_tlb_ready && _cpu_tlb_flushed[cpu_current_index()] < _cpu_tlb_generation)
+        _cpu_tlb_flush();
+}
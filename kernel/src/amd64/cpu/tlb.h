@@ -0,0 +1,56 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+#pragma once
+#include <api/types.h>
+
+//----------------------------------------------------------------------------//
+// TLB - Constants
+//----------------------------------------------------------------------------//
+
+#define TLB_CR4_PGE                 (1 << 7)    // Global pages
+
+//----------------------------------------------------------------------------//
+// TLB
+//----------------------------------------------------------------------------//
+
+/**
+ * Registers the shootdown IPI handler.
+ *
+ * Only to be called once on the BSP after all CPUs have been added.
+ */
+void cpu_tlb_init(void);
+
+/**
+ * Flushes the TLBs of all other started CPUs, including global entries, and
+ * waits until they have done so.
+ *
+ * Pages unmapped before the call can afterwards not be accessed through stale
+ * translations anymore, so their frames and addresses may be reused. Must not
+ * be called while holding a lock other CPUs might spin on with interrupts
+ * disabled, unless they keep calling <tt>cpu_tlb_poll</tt> while spinning.
+ */
+void cpu_tlb_shootdown(void);
+
+/**
+ * Flushes the current CPU's TLB, if a shootdown is pending for it.
+ *
+ * To be called while spinning with interrupts disabled on locks that may be
+ * held by a CPU waiting in <tt>cpu_tlb_shootdown</tt>.
+ */
+void cpu_tlb_poll(void);
@@ -0,0 +1,164 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+
+#include <api/types.h>
+#include <api/cpu.h>
+
+#include <api/debug/console.h>
+
+#include <amd64/cpu.h>
+#include <amd64/cpu/topology.h>
+
+//----------------------------------------------------------------------------//
+// Topology - Constants
+//----------------------------------------------------------------------------//
+
+/**
+ * Level types reported by the extended topology leaf.
+ */
+#define TOPOLOGY_LEVEL_INVALID      0
+#define TOPOLOGY_LEVEL_SMT          1
+#define TOPOLOGY_LEVEL_CORE         2
+
+/**
+ * Hyper-threading bit in <tt>EDX</tt> of leaf 0x01.
+ */
+#define TOPOLOGY_HTT                (1 << 28)
+
+//----------------------------------------------------------------------------//
+// Topology - Internal
+//----------------------------------------------------------------------------//
+
+/**
+ * Returns the number of bits required to number the given count of items.
+ *
+ * @param count The count.
+ * @return The number of bits.
+ */
+static uint32_t _cpu_topology_bits(uint32_t count)
+{
+    return (count > 1) ? 32 - __builtin_clz(count - 1) : 0;
+}
+
+/**
+ * Determines the APIC id shifts of the core and package fields with the
+ * extended topology leaf.
+ *
+ * @param core_shift Set to the width of the SMT field.
+ * @param package_shift Set to the width of the SMT and core fields.
+ * @return Whether the leaf is supported.
+ */
+static bool _cpu_topology_extended(uint32_t *core_shift, uint32_t *package_shift)
+{
+    cpu_cpuid_t regs;
+    cpu_cpuid(0x0B, 0, &regs);
+    
+    // Not supported?
+    if (0 == regs.ebx)
+        return false;
+        
+    // Walk levels up to the package
+    uint32_t level;
+    
+    for (level = 0; ; ++level) {
+        cpu_cpuid(0x0B, level, &regs);
+        
+        uint32_t type = (regs.ecx >> 8) & 0xFF;
+        uint32_t shift = regs.eax & 0x1F;
+        
+        if (TOPOLOGY_LEVEL_INVALID == type)
+            break;
+            
+        if (TOPOLOGY_LEVEL_SMT == type)
+            *core_shift = shift;
+            
+        *package_shift = shift;
+    }
+    
+    return true;
+}
+
+/**
+ * Determines the APIC id shifts of the core and package fields with the
+ * legacy leaves 0x01 and 0x04.
+ *
+ * @param core_shift Set to the width of the SMT field.
+ * @param package_shift Set to the width of the SMT and core fields.
+ */
+static void _cpu_topology_legacy(uint32_t *core_shift, uint32_t *package_shift)
+{
+    cpu_cpuid_t regs;
+    cpu_cpuid(0x01, 0, &regs);
+    
+    // Single logical processor per package?
+    if (0 == (regs.edx & TOPOLOGY_HTT))
+        return;
+        
+    uint32_t logical = (regs.ebx >> 16) & 0xFF;
+    
+    // Cores per package (leaf is zero if not supported)
+    cpu_cpuid(0x04, 0, &regs);
+    uint32_t cores = ((regs.eax >> 26) & 0x3F) + 1;
+    
+    if (cores > logical)
+        cores = logical;
+        
+    *package_shift = _cpu_topology_bits(logical);
+    *core_shift = _cpu_topology_bits(logical / cores);
+}
+
+//----------------------------------------------------------------------------//
+// Topology
+//----------------------------------------------------------------------------//
+
+void cpu_topology_init(void)
+{
+    uint32_t core_shift = 0;
+    uint32_t package_shift = 0;
+    
+    // Determine the APIC id layout (same on all CPUs)
+    if (!_cpu_topology_extended(&core_shift, &package_shift))
+        _cpu_topology_legacy(&core_shift, &package_shift);
+        
+    // Assign cores and packages
+    size_t i;
+    
+    for (i = 0; i < cpu_count(); ++i) {
+        cpu_t *cpu = cpu_get_index(i);
+        cpu->core = cpu->id >> core_shift;
+        cpu->package = cpu->id >> package_shift;
+    }
+    
+    console_debug("[SMP ] Topology: ");
+    console_debug_dec((intptr_t) core_shift);
+    console_debug(" SMT bits, ");
+    console_debug_dec((intptr_t) (package_shift - core_shift));
+    console_debug(" core bits\n");
+}
+
+uint8_t cpu_topology_distance(cpu_t *a, cpu_t *b)
+{
+    if (a->core == b->core)
+        return CPU_TOPOLOGY_SIBLING;
+        
+    if (a->package == b->package)
+        return CPU_TOPOLOGY_PACKAGE;
+        
+    return CPU_TOPOLOGY_REMOTE;
+}
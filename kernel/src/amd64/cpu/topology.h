@@ -0,0 +1,50 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+#pragma once
+#include <api/types.h>
+#include <api/cpu.h>
+
+//----------------------------------------------------------------------------//
+// Topology - Distances
+//----------------------------------------------------------------------------//
+
+#define CPU_TOPOLOGY_SIBLING        0       // Same core (SMT)
+#define CPU_TOPOLOGY_PACKAGE        1       // Same package
+#define CPU_TOPOLOGY_REMOTE         2       // Different packages
+
+//----------------------------------------------------------------------------//
+// Topology
+//----------------------------------------------------------------------------//
+
+/**
+ * Determines how APIC ids split into package, core and SMT fields and assigns
+ * each CPU its core and package.
+ *
+ * Only to be called once on the BSP after all CPUs have been added.
+ */
+void cpu_topology_init(void);
+
+/**
+ * Returns how closely the given CPUs are related.
+ *
+ * @param a The first CPU.
+ * @param b The second CPU.
+ * @return One of the <tt>CPU_TOPOLOGY_*</tt> distances.
+ */
+uint8_t cpu_topology_distance(cpu_t *a, cpu_t *b);
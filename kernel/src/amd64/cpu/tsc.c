@@ -0,0 +1,127 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+#include <api/types.h>
+#include <amd64/cpu.h>
+#include <amd64/cpu/features.h>
+
+//----------------------------------------------------------------------------//
+// TSC - Constants
+//----------------------------------------------------------------------------//
+
+/**
+ * MSR whose value RDTSCP returns along with the TSC.
+ */
+#define CPU_TSC_AUX_MSR             0xC0000103
+
+//----------------------------------------------------------------------------//
+// TSC - Variables
+//----------------------------------------------------------------------------//
+
+/**
+ * The TSC's frequency in Hz.
+ */
+static uint64_t cpu_tsc_hz = 0;
+
+/**
+ * Whether <tt>IA32_TSC_AUX</tt> holds the logical number of each CPU, so
+ * RDTSCP returns it along with the TSC.
+ */
+static bool cpu_tsc_rdtscp = false;
+
+//----------------------------------------------------------------------------//
+// TSC - Internal
+//----------------------------------------------------------------------------//
+
+/**
+ * Determines the TSC frequency from CPUID leaves 0x15 (TSC/crystal ratio)
+ * and 0x16 (processor base frequency).
+ *
+ * @return The frequency in Hz or <tt>0</tt>, if not enumerated.
+ */
+static uint64_t _cpu_tsc_cpuid_frequency(void)
+{
+    cpu_cpuid_t tsc, freq;
+    cpu_cpuid(0x15, 0, &tsc);
+    
+    // No TSC/crystal ratio?
+    if (0 == tsc.eax || 0 == tsc.ebx)
+        return 0;
+        
+    // Crystal frequency enumerated?
+    if (0 != tsc.ecx)
+        return ((uint64_t) tsc.ecx * tsc.ebx) / tsc.eax;
+        
+    // Otherwise the TSC runs at the base frequency
+    cpu_cpuid(0x16, 0, &freq);
+    return (uint64_t) (freq.eax & 0xFFFF) * 1000000;
+}
+
+//----------------------------------------------------------------------------//
+// TSC
+//----------------------------------------------------------------------------//
+
+uint64_t cpu_tsc_read(void)
+{
+    uint32_t low, high;
+    asm volatile ("rdtsc" : "=a" (low), "=d" (high));
+    return ((uint64_t) high << 32) | low;
+}
+
+uint64_t cpu_tsc_read_ordered(void)
+{
+    uint32_t low, high;
+    asm volatile ("lfence; rdtsc" : "=a" (low), "=d" (high) :: "memory");
+    return ((uint64_t) high << 32) | low;
+}
+
+uint64_t cpu_tsc_read_index(size_t *index)
+{
+    uint32_t low, high, aux;
+    
+    if (cpu_tsc_rdtscp) {
+        asm volatile ("rdtscp" : "=a" (low), "=d" (high), "=c" (aux));
+        *index = aux;
+    } else {
+        asm volatile ("rdtsc" : "=a" (low), "=d" (high));
+        *index = cpu_current_index();
+    }
+    
+    return ((uint64_t) high << 32) | low;
+}
+
+void cpu_tsc_load(void)
+{
+    if (!cpu_feature_present(CPU_FEATURE_RDTSCP))
+        return;
+        
+    cpu_msr_write(CPU_TSC_AUX_MSR, cpu_current_index());
+    cpu_tsc_rdtscp = true;
+}
+
+uint64_t cpu_tsc_calibrate(uint64_t measured_hz)
+{
+    uint64_t hz = _cpu_tsc_cpuid_frequency();
+    cpu_tsc_hz = (0 != hz) ? hz : measured_hz;
+    return cpu_tsc_hz;
+}
+
+uint64_t cpu_tsc_frequency(void)
+{
+    return cpu_tsc_hz;
+}
@@ -0,0 +1,435 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+#include <api/types.h>
+#include <api/compiler.h>
+#include <api/string.h>
+#include <api/debug/console.h>
+#include <api/memory/heap.h>
+#include <api/memory/page.h>
+#include <api/memory/frame.h>
+#include <api/cpu/int.h>
+#include <api/multitasking/thread.h>
+#include <amd64/cpu.h>
+#include <amd64/debug/bench.h>
+#include <amd64/multitasking/thread.h>
+
+//----------------------------------------------------------------------------//
+// Benchmarks - Constants
+//----------------------------------------------------------------------------//
+
+/**
+ * Virtual address used by the paging benchmark.
+ */
+#define BENCH_PAGE_VIRT         0xFFFFFF7F00000000
+
+/**
+ * Size of the buffers used by the memory utility benchmarks.
+ */
+#define BENCH_MEM_SIZE          0x1000
+
+/**
+ * Vectors used by the interrupt entry benchmarks.
+ */
+#define BENCH_INT_FULL          0xE0
+#define BENCH_INT_FAST          0xE1
+
+/**
+ * Size of the strings used by the string routine benchmarks.
+ */
+#define BENCH_STR_SIZE          0x400
+
+/**
+ * Size of the stack of the context switch benchmark's partner context.
+ */
+#define BENCH_SWITCH_STACK_SIZE 0x1000
+
+/**
+ * Number of threads per CPU the parallel work benchmark splits its work into.
+ */
+#define BENCH_WORK_THREADS      4
+
+//----------------------------------------------------------------------------//
+// Benchmarks - Variables
+//----------------------------------------------------------------------------//
+
+static uint8_t bench_mem_src[BENCH_MEM_SIZE * 2];
+static uint8_t bench_mem_dest[BENCH_MEM_SIZE];
+
+static int8_t bench_str_a[BENCH_STR_SIZE];
+static int8_t bench_str_b[BENCH_STR_SIZE];
+static int8_t bench_str_needle[] = "aaaaaaaaaaaaaaab";
+
+static thread_t bench_switch_main;
+static thread_t bench_switch_partner;
+static uint64_t bench_switch_stack[BENCH_SWITCH_STACK_SIZE / 8] ALIGNED(16);
+
+//----------------------------------------------------------------------------//
+// Benchmarks - Reference Implementations
+//----------------------------------------------------------------------------//
+
+// Byte-at-a-time versions the optimized string routines are compared against
+
+static size_t _bench_ref_strlen(const int8_t *str)
+{
+    size_t len;
+    for (len = 0; 0 != str[len]; ++len);
+    return len;
+}
+
+static int _bench_ref_strcmp(const int8_t *a, const int8_t *b)
+{
+    size_t i;
+    for (i = 0; a[i] == b[i] && 0 != a[i]; ++i);
+    return (uint8_t) a[i] - (uint8_t) b[i];
+}
+
+static int _bench_ref_memcmp(void *a, void *b, size_t len)
+{
+    size_t i;
+    for (i = 0; i < len; ++i)
+        if (((uint8_t *) a)[i] != ((uint8_t *) b)[i])
+            return ((uint8_t *) a)[i] - ((uint8_t *) b)[i];
+            
+    return 0;
+}
+
+static const int8_t *_bench_ref_strstr(const int8_t *haystack, const int8_t *needle)
+{
+    size_t i, j;
+    
+    for (i = 0; 0 != haystack[i]; ++i) {
+        for (j = 0; 0 != needle[j] && haystack[i + j] == needle[j]; ++j);
+        
+        if (0 == needle[j])
+            return &haystack[i];
+    }
+    
+    return 0;
+}
+
+//----------------------------------------------------------------------------//
+// Benchmarks - Bodies
+//----------------------------------------------------------------------------//
+
+static void _bench_heap_small(size_t iterations)
+{
+    size_t i;
+    for (i = 0; i < iterations; ++i)
+        free(malloc(64));
+}
+
+static void _bench_heap_large(size_t iterations)
+{
+    size_t i;
+    for (i = 0; i < iterations; ++i)
+        free(malloc(256 * 1024));
+}
+
+static void _bench_page_map(size_t iterations)
+{
+    uintptr_t phys = frame_alloc();
+    size_t i;
+    
+    for (i = 0; i < iterations; ++i) {
+        page_map(BENCH_PAGE_VIRT, phys, PG_PRESENT | PG_WRITABLE);
+        page_unmap(BENCH_PAGE_VIRT);
+    }
+    
+    frame_free(phys);
+}
+
+static void _bench_memcpy_small(size_t iterations)
+{
+    size_t i;
+    for (i = 0; i < iterations; ++i)
+        memcpy(bench_mem_dest, bench_mem_src, 64);
+}
+
+static void _bench_memcpy_page(size_t iterations)
+{
+    size_t i;
+    for (i = 0; i < iterations; ++i)
+        memcpy(bench_mem_dest, bench_mem_src, BENCH_MEM_SIZE);
+}
+
+static void _bench_memcpy_unaligned(size_t iterations)
+{
+    size_t i;
+    for (i = 0; i < iterations; ++i)
+        memcpy(bench_mem_dest + 1, bench_mem_src + 3, BENCH_MEM_SIZE - 8);
+}
+
+static void _bench_memmove_overlap(size_t iterations)
+{
+    size_t i;
+    for (i = 0; i < iterations; ++i)
+        memmove(bench_mem_src + 160, bench_mem_src, BENCH_MEM_SIZE);
+}
+
+static void _bench_memset_page(size_t iterations)
+{
+    size_t i;
+    for (i = 0; i < iterations; ++i)
+        memset(bench_mem_dest, (uint8_t) i, BENCH_MEM_SIZE);
+}
+
+static void _bench_page_zero(size_t iterations)
+{
+    uintptr_t phys = frame_alloc();
+    size_t i;
+    
+    for (i = 0; i < iterations; ++i)
+        page_zero(phys);
+        
+    frame_free(phys);
+}
+
+static void _bench_page_copy(size_t iterations)
+{
+    uintptr_t dest = frame_alloc();
+    uintptr_t src = frame_alloc();
+    size_t i;
+    
+    for (i = 0; i < iterations; ++i)
+        page_copy(dest, src);
+        
+    frame_free(src);
+    frame_free(dest);
+}
+
+/**
+ * Fills both benchmark strings with the same run of 'a's.
+ */
+static void _bench_str_setup(void)
+{
+    memset(bench_str_a, 'a', BENCH_STR_SIZE - 1);
+    memset(bench_str_b, 'a', BENCH_STR_SIZE - 1);
+    bench_str_a[BENCH_STR_SIZE - 1] = 0;
+    bench_str_b[BENCH_STR_SIZE - 1] = 0;
+}
+
+static void _bench_strlen(size_t iterations)
+{
+    size_t i;
+    for (i = 0; i < iterations; ++i)
+        bench_str_b[0] = (int8_t) strlen(bench_str_a);
+}
+
+static void _bench_strlen_ref(size_t iterations)
+{
+    size_t i;
+    for (i = 0; i < iterations; ++i)
+        bench_str_b[0] = (int8_t) _bench_ref_strlen(bench_str_a);
+}
+
+static void _bench_strcmp(size_t iterations)
+{
+    size_t i;
+    for (i = 0; i < iterations; ++i)
+        bench_str_a[0] = 'a' + strcmp(bench_str_a, bench_str_b);
+}
+
+static void _bench_strcmp_ref(size_t iterations)
+{
+    size_t i;
+    for (i = 0; i < iterations; ++i)
+        bench_str_a[0] = 'a' + _bench_ref_strcmp(bench_str_a, bench_str_b);
+}
+
+static void _bench_memcmp(size_t iterations)
+{
+    size_t i;
+    for (i = 0; i < iterations; ++i)
+        bench_str_a[0] = 'a' + memcmp(bench_str_a, bench_str_b, BENCH_STR_SIZE);
+}
+
+static void _bench_memcmp_ref(size_t iterations)
+{
+    size_t i;
+    for (i = 0; i < iterations; ++i)
+        bench_str_a[0] = 'a' +
+            _bench_ref_memcmp(bench_str_a, bench_str_b, BENCH_STR_SIZE);
+}
+
+static void _bench_strstr(size_t iterations)
+{
+    size_t i;
+    for (i = 0; i < iterations; ++i)
+        bench_str_b[0] = 'a' + (0 != strstr(bench_str_a, bench_str_needle));
+}
+
+static void _bench_strstr_ref(size_t iterations)
+{
+    size_t i;
+    for (i = 0; i < iterations; ++i)
+        bench_str_b[0] = 'a' +
+            (0 != _bench_ref_strstr(bench_str_a, bench_str_needle));
+}
+
+static void *_bench_int_full_handler(interrupt_vector_t vector, void *ctx)
+{
+    return ctx;
+}
+
+static void _bench_int_fast_handler(interrupt_vector_t vector)
+{
+}
+
+static void _bench_int_full(size_t iterations)
+{
+    cpu_int_register(BENCH_INT_FULL, &_bench_int_full_handler);
+    
+    size_t i;
+    for (i = 0; i < iterations; ++i)
+        asm volatile ("int $0xE0" ::: "memory");
+}
+
+static void _bench_int_fast(size_t iterations)
+{
+    cpu_int_register_irq(BENCH_INT_FAST, &_bench_int_fast_handler);
+    
+    size_t i;
+    for (i = 0; i < iterations; ++i)
+        asm volatile ("int $0xE1" ::: "memory");
+}
+
+/**
+ * Partner context of the context switch benchmark; switches right back.
+ */
+static void _bench_switch_partner_loop(void)
+{
+    while (1)
+        thread_context_switch(&bench_switch_partner, &bench_switch_main);
+}
+
+static void _bench_switch(size_t iterations)
+{
+    // Stack of a context that called thread_context_switch from the loop,
+    // with zeroed callee-saved registers and a fake return address on top
+    uint64_t *sp = &bench_switch_stack[BENCH_SWITCH_STACK_SIZE / 8];
+    *--sp = 0;
+    *--sp = (uint64_t) (uintptr_t) &_bench_switch_partner_loop;
+    sp -= 6;
+    memset(sp, 0, 6 * sizeof(uint64_t));
+    bench_switch_partner.sp = (uintptr_t) sp;
+    
+    // Switch there and back (one round trip per iteration)
+    size_t i;
+    for (i = 0; i < iterations; ++i)
+        thread_context_switch(&bench_switch_main, &bench_switch_partner);
+}
+
+static void _bench_thread_noop(void *arg)
+{
+}
+
+static void _bench_thread_create_join(size_t iterations)
+{
+    size_t i;
+    for (i = 0; i < iterations; ++i)
+        thread_join(thread_create(&_bench_thread_noop, 0));
+}
+
+/**
+ * Busy work of the parallel work benchmark.
+ *
+ * @param arg The number of iterations.
+ */
+static void _bench_work(void *arg)
+{
+    size_t iterations = (size_t) (uintptr_t) arg;
+    volatile uint64_t value = 1;
+    size_t i;
+    
+    for (i = 0; i < iterations * 1000; ++i)
+        value = value * 6364136223846793005ULL + 1442695040888963407ULL;
+}
+
+static void _bench_work_serial(size_t iterations)
+{
+    size_t i;
+    for (i = 0; i < BENCH_WORK_THREADS * cpu_count(); ++i)
+        _bench_work((void *) (uintptr_t) iterations);
+}
+
+static void _bench_work_parallel(size_t iterations)
+{
+    size_t count = BENCH_WORK_THREADS * cpu_count();
+    thread_t **threads = malloc(count * sizeof(thread_t *));
+    size_t i;
+    
+    for (i = 0; i < count; ++i)
+        threads[i] = thread_create(&_bench_work, (void *) (uintptr_t) iterations);
+        
+    for (i = 0; i < count; ++i)
+        thread_join(threads[i]);
+        
+    free(threads);
+}
+
+//----------------------------------------------------------------------------//
+// Benchmarks
+//----------------------------------------------------------------------------//
+
+void bench_measure(const char *name, bench_body_t body, size_t iterations)
+{
+    // Run body
+    uint64_t begin = cpu_tsc_read();
+    body(iterations);
+    uint64_t cycles = cpu_tsc_read() - begin;
+    
+    // Print result
+    console_print("[BNCH] ");
+    console_print(name);
+    console_print(": ");
+    console_print_dec((intptr_t) (cycles / iterations));
+    console_print(" cycles\n");
+}
+
+void bench_run(void)
+{
+    bench_measure("malloc/free 64 B", &_bench_heap_small, 10000);
+    bench_measure("malloc/free 256 KiB", &_bench_heap_large, 100);
+    bench_measure("page_map/page_unmap", &_bench_page_map, 10000);
+    bench_measure("memcpy 64 B", &_bench_memcpy_small, 100000);
+    bench_measure("memcpy 4 KiB", &_bench_memcpy_page, 10000);
+    bench_measure("memcpy 4 KiB unaligned", &_bench_memcpy_unaligned, 10000);
+    bench_measure("memmove 4 KiB overlapping", &_bench_memmove_overlap, 10000);
+    bench_measure("memset 4 KiB", &_bench_memset_page, 10000);
+    bench_measure("page_zero", &_bench_page_zero, 10000);
+    bench_measure("page_copy", &_bench_page_copy, 10000);
+    
+    bench_measure("int (full entry)", &_bench_int_full, 10000);
+    bench_measure("int (fast IRQ entry)", &_bench_int_fast, 10000);
+    
+    bench_measure("context switch (round trip)", &_bench_switch, 100000);
+    bench_measure("thread_create/thread_join", &_bench_thread_create_join, 1000);
+    bench_measure("busy work (one CPU)", &_bench_work_serial, 100);
+    bench_measure("busy work (all CPUs)", &_bench_work_parallel, 100);
+    
+    _bench_str_setup();
+    bench_measure("strlen 1 KiB", &_bench_strlen, 10000);
+    bench_measure("strlen 1 KiB (bytewise)", &_bench_strlen_ref, 10000);
+    bench_measure("strcmp 1 KiB", &_bench_strcmp, 10000);
+    bench_measure("strcmp 1 KiB (bytewise)", &_bench_strcmp_ref, 10000);
+    bench_measure("memcmp 1 KiB", &_bench_memcmp, 10000);
+    bench_measure("memcmp 1 KiB (bytewise)", &_bench_memcmp_ref, 10000);
+    bench_measure("strstr a^1023 / a^15b", &_bench_strstr, 1000);
+    bench_measure("strstr a^1023 / a^15b (naive)", &_bench_strstr_ref, 1000);
+}
@@ -0,0 +1,52 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+#pragma once
+#include <api/types.h>
+
+//----------------------------------------------------------------------------//
+// Benchmarks - Types
+//----------------------------------------------------------------------------//
+
+/**
+ * The body of a microbenchmark.
+ *
+ * @param iterations The number of iterations to run.
+ */
+typedef void (*bench_body_t)(size_t);
+
+//----------------------------------------------------------------------------//
+// Benchmarks
+//----------------------------------------------------------------------------//
+
+/**
+ * Runs the given benchmark body and prints the average number of TSC cycles
+ * per iteration.
+ *
+ * @param name The name of the benchmark to print.
+ * @param body The benchmark's body.
+ * @param iterations The number of iterations to pass to the body.
+ */
+void bench_measure(const char *name, bench_body_t body, size_t iterations);
+
+/**
+ * Runs all microbenchmarks and prints their results to the console.
+ *
+ * Only called when the kernel is built with <tt>BENCH=1</tt>.
+ */
+void bench_run(void);
@@ -18,6 +18,7 @@
 
 #include <api/types.h>
 #include <api/compiler.h>
+#include <api/string.h>
 #include <api/debug/console.h>
 #include <amd64/debug/console.h>
 #include <amd64/io/io.h>
@@ -57,14 +58,15 @@ static void _console_scroll()
         return;
     
     // Move up the screens contents one line
-    size_t i;
+    memmove(
+        (void *) console_videomem,
+        (void *) &console_videomem[CONSOLE_WIDTH],
+        CONSOLE_WIDTH * (CONSOLE_HEIGHT - 1) * sizeof(uint16_t));
     
-    for (i = CONSOLE_WIDTH; i < CONSOLE_WIDTH * CONSOLE_HEIGHT; ++i)
-        console_videomem[i - CONSOLE_WIDTH] = console_videomem[i];
-        
     // Clear last line
     uint16_t cell = CONSOLE_CELL(' ', console_color_fg, console_color_bg);
-        
+    size_t i;
+    
     for (i = CONSOLE_WIDTH * (CONSOLE_HEIGHT - 1); i < CONSOLE_WIDTH * CONSOLE_HEIGHT; ++i)
         console_videomem[i] = cell;
     
@@ -32,8 +32,11 @@
 #include <amd64/info/acpi.h>
 
 #include <amd64/cpu.h>
+#include <amd64/cpu/features.h>
 
 #include <amd64/cpu/lapic.h>
+#include <amd64/cpu/ioapic.h>
+#include <amd64/cpu/hpet.h>
 
 //----------------------------------------------------------------------------//
 // ACPI - Constants
@@ -95,7 +98,7 @@ static void _acpi_tmp_unmap_all()
 static bool _acpi_rsdp_check(acpi_rsdp_t *rsdp)
 {
     // Check signature
-    if (!memcmp((int8_t *) &rsdp->signature, (int8_t *) "RSD PTR ", 8))
+    if (0 != memcmp((int8_t *) &rsdp->signature, (int8_t *) "RSD PTR ", 8))
         return false;
         
     // Checksum
@@ -203,9 +206,36 @@ static void _acpi_parse_madt_lapic(acpi_madt_lapic_t *lapic_tbl)
     cpu_add(cpu);
 }
 
+static void _acpi_parse_madt_x2apic(acpi_madt_x2apic_t *x2apic_tbl)
+{
+    // Ids above 255 are only reachable in x2APIC mode
+    if (x2apic_tbl->x2apic_id > 0xFF && !cpu_feature_present(CPU_FEATURE_X2APIC))
+        return;
+        
+    // Already listed as LAPIC?
+    if (0 != cpu_get(x2apic_tbl->x2apic_id))
+        return;
+        
+    // Flags
+    uint8_t flags = 0;
+    if (x2apic_tbl->flags & ACPI_MADT_LAPIC_ENABLED)
+        flags |= CPU_FLAG_ENABLED;
+        
+    // Create processor
+    cpu_t cpu = {x2apic_tbl->x2apic_id, flags};
+    cpu_add(cpu);
+}
+
 static void _acpi_parse_madt_io_apic(acpi_madt_io_apic_t *apic_tbl)
 {
-    // TODO: Add I/O APIC
+    cpu_ioapic_add(apic_tbl->apic_id, apic_tbl->address, apic_tbl->int_base);
+}
+
+static void _acpi_parse_madt_iso(acpi_madt_iso_t *iso_tbl)
+{
+    // Only ISA overrides are defined
+    if (0 == iso_tbl->bus)
+        cpu_ioapic_override(iso_tbl->source, iso_tbl->gsi, iso_tbl->flags);
 }
 
 static void _acpi_parse_madt(acpi_madt_t *madt)
@@ -227,12 +257,31 @@ static void _acpi_parse_madt(acpi_madt_t *madt)
         // I/O APIC
         else if (ACPI_MADT_IO_APIC_TYPE == generic[0])
             _acpi_parse_madt_io_apic((acpi_madt_io_apic_t *) current);
+            
+        // x2APIC?
+        else if (ACPI_MADT_X2APIC_TYPE == generic[0])
+            _acpi_parse_madt_x2apic((acpi_madt_x2apic_t *) current);
+            
+        // Interrupt Source Override
+        else if (ACPI_MADT_ISO_TYPE == generic[0])
+            _acpi_parse_madt_iso((acpi_madt_iso_t *) current);
         
         // Next table
         current = (void *) ((uintptr_t) current + generic[1]);
     }
 }
 
+//----------------------------------------------------------------------------//
+// ACPI - Internal - HPET Parsing
+//----------------------------------------------------------------------------//
+
+static void _acpi_parse_hpet(acpi_hpet_t *hpet)
+{
+    // Only memory mapped HPETs are defined
+    if (ACPI_ADDRESS_SPACE_MEMORY == hpet->address.space_id)
+        cpu_hpet_set(hpet->address.address);
+}
+
 //----------------------------------------------------------------------------//
 // ACPI - Parsing
 //----------------------------------------------------------------------------//
@@ -258,10 +307,13 @@ void acpi_parse()
         header = (acpi_sdt_header_t *) _acpi_tmp_map((uintptr_t) header, length);
         
         // Check on table's parse
-        if (memcmp((int8_t *) header->signature, (void *) "APIC", 4) ||
-            memcmp((int8_t *) header->signature, (void *) "MADT", 4))
+        if (0 == memcmp((int8_t *) header->signature, (void *) "APIC", 4) ||
+            0 == memcmp((int8_t *) header->signature, (void *) "MADT", 4))
             _acpi_parse_madt((acpi_madt_t *) header);
             
+        else if (0 == memcmp((int8_t *) header->signature, (void *) "HPET", 4))
+            _acpi_parse_hpet((acpi_hpet_t *) header);
+            
         // Unmap
         _acpi_tmp_unmap_all();
     }
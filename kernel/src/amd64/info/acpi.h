@@ -183,6 +183,8 @@ typedef struct acpi_fadt_t
  * Structure is followed by several structures, including
  *  * acpi_madt_lapic_t
  *  * acpi_madt_io_apic_t
+ *  * acpi_madt_iso_t
+ *  * acpi_madt_x2apic_t
  */
 typedef struct acpi_madt_t
 {
@@ -206,6 +208,8 @@ typedef struct acpi_madt_t
 #define ACPI_MADT_LAPIC_ENABLED (1 << 0)
 #define ACPI_MADT_LAPIC_TYPE 0
 #define ACPI_MADT_IO_APIC_TYPE 1
+#define ACPI_MADT_ISO_TYPE 2
+#define ACPI_MADT_X2APIC_TYPE 9
 
 /**
  * Entry in MADT for Processor LAPICs (Type 0)
@@ -276,6 +280,147 @@ typedef struct acpi_madt_io_apic_t
     uint32_t int_base;
 } PACKED acpi_madt_io_apic_t;
 
+/**
+ * Entry in MADT for Interrupt Source Overrides (Type 2).
+ */
+typedef struct acpi_madt_iso_t
+{
+    /**
+     * Type of the MADT entry (Value 2).
+     */
+    uint8_t type;
+    
+    /**
+     * Length of this MADT entry (Value 10).
+     */
+    uint8_t length;
+    
+    /**
+     * The bus the source is on (Value 0, ISA).
+     */
+    uint8_t bus;
+    
+    /**
+     * The bus-relative IRQ that is overridden.
+     */
+    uint8_t source;
+    
+    /**
+     * The Global System Interrupt the IRQ is connected to.
+     */
+    uint32_t gsi;
+    
+    /**
+     * MPS INTI flags (polarity and trigger mode).
+     */
+    uint16_t flags;
+} PACKED acpi_madt_iso_t;
+
+/**
+ * Entry in MADT for Processor x2APICs (Type 9).
+ */
+typedef struct acpi_madt_x2apic_t
+{
+    /**
+     * Type of the MADT entry (Value 9).
+     */
+    uint8_t type;
+    
+    /**
+     * Length of this MADT entry (Value 16).
+     */
+    uint8_t length;
+    
+    /**
+     * Two reserved bytes.
+     */
+    uint16_t reserved;
+    
+    /**
+     * The processor's (32 bit) x2APIC id.
+     */
+    uint32_t x2apic_id;
+    
+    /**
+     * Local APIC flags (same as for acpi_madt_lapic_t).
+     */
+    uint32_t flags;
+    
+    /**
+     * The processor's ACPI UID.
+     */
+    uint32_t acpi_uid;
+} PACKED acpi_madt_x2apic_t;
+
+//----------------------------------------------------------------------------//
+// ACPI - HPET
+//----------------------------------------------------------------------------//
+
+#define ACPI_ADDRESS_SPACE_MEMORY 0
+
+/**
+ * Generic Address Structure.
+ */
+typedef struct acpi_address_t
+{
+    /**
+     * The address space (0 for system memory, 1 for system I/O).
+     */
+    uint8_t space_id;
+    
+    /**
+     * Register width and offset in bits.
+     */
+    uint8_t bit_width;
+    uint8_t bit_offset;
+    
+    /**
+     * Access size.
+     */
+    uint8_t access_size;
+    
+    /**
+     * The (64 bit) address in the given address space.
+     */
+    uint64_t address;
+} PACKED acpi_address_t;
+
+/**
+ * High Precision Event Timer Table (SDT signature "HPET").
+ */
+typedef struct acpi_hpet_t
+{
+    /**
+     * Header of this SDT.
+     */
+    acpi_sdt_header_t header;
+    
+    /**
+     * Hardware id of the event timer block.
+     */
+    uint32_t block_id;
+    
+    /**
+     * Address of the event timer block's registers.
+     */
+    acpi_address_t address;
+    
+    /**
+     * The HPET's sequence number.
+     */
+    uint8_t number;
+    
+    /**
+     * Minimum clock tick for periodic mode.
+     */
+    uint16_t min_tick;
+    
+    /**
+     * Page protection and OEM attributes.
+     */
+    uint8_t page_protection;
+} PACKED acpi_hpet_t;
+
 //----------------------------------------------------------------------------//
 // ACPI - Parsing
 //----------------------------------------------------------------------------//
@@ -32,7 +32,10 @@
 #include <api/memory/heap.h>
 #include <api/memory/frame.h>
 
+#include <api/multitasking/thread.h>
+
 #include <amd64/debug/console.h>
+#include <amd64/debug/bench.h>
 #include <amd64/boot/info.h>
 #include <amd64/info/acpi.h>
 #include <amd64/util/time.h>
@@ -42,8 +45,11 @@
 #include <amd64/memory/page.h>
 
 #include <amd64/cpu.h>
+#include <amd64/cpu/features.h>
 #include <amd64/cpu/int.h>
 #include <amd64/cpu/lapic.h>
+#include <amd64/cpu/ioapic.h>
+#include <amd64/cpu/percpu.h>
 
 static void pg_fault(interrupt_vector_t vector, void *ctx)
 {
@@ -60,6 +66,16 @@ static void pg_fault(interrupt_vector_t vector, void *ctx)
 
 int main(void)
 {
+    // Boot start
+    uint64_t boot_tsc = cpu_tsc_read();
+    
+    // Per-CPU variables are usable from here on
+    cpu_percpu_boot();
+    
+    // Detect processor features and select optimized implementations
+    cpu_features_init();
+    cpu_alternatives_apply();
+    
     // Relocate video memory
     console_memory_relocate(CONSOLE_MEM_VIRTUAL);
 
@@ -78,24 +94,24 @@ int main(void)
     // Print info
     boot_info_t *info = (boot_info_t *) BOOT_INFO_VIRTUAL;
 
-    console_print("Entry: ");
-    console_print_hex(info->entry_point);
+    console_debug("Entry: ");
+    console_debug_hex(info->entry_point);
     
-    console_print("\nLoader: ");
-    console_print((int8_t *) info->loader_name);
+    console_debug("\nLoader: ");
+    console_debug((int8_t *) info->loader_name);
     
-    console_print("\nCommand: ");
-    console_print((int8_t *) info->args);
-    console_print("\n");
-    console_print(spacer);
-    console_print("\n");
+    console_debug("\nCommand: ");
+    console_debug((int8_t *) info->args);
+    console_debug("\n");
+    console_debug(spacer);
+    console_debug("\n");
     
     // Set up frame heap
-    console_print("[CORE] Initializing frame heap...\n");
+    console_debug("[CORE] Initializing frame heap...\n");
     frame_setup(info, (void *) mem_align(info->free_mem_begin, 0x1000));
     
     // Initialize paging
-    console_print("[CORE] Initializing paging...\n");
+    console_debug("[CORE] Initializing paging...\n");
     uintptr_t pml4 = cpu_get_cr3();
     page_init(pml4, pml4);
     
@@ -105,11 +121,11 @@ int main(void)
     
     // Copy info data to other physical frame
     uintptr_t info_phys = frame_alloc();
-    memcpy((void *) info_phys, (void *) BOOT_INFO_VIRTUAL, 0x1000);
+    page_copy(info_phys, page_get_physical(BOOT_INFO_VIRTUAL));
     page_map(BOOT_INFO_VIRTUAL, info_phys, PG_GLOBAL | PG_PRESENT);
     
     // Initialize interrupts
-    console_print("[CORE] Initializing interrupts...\n");
+    console_debug("[CORE] Initializing interrupts...\n");
     cpu_int_init();
     cpu_int_load();
     
@@ -117,28 +133,47 @@ int main(void)
     cpu_int_register(0, (interrupt_handler_t) &pg_fault);
     
     // Parse ACPI tables and create sysinfo structure
-    console_print("[INFO] Parsing ACPI tables...\n");
+    console_debug("[INFO] Parsing ACPI tables...\n");
     acpi_parse();
     
     // Print some information found in the ACPI tables...
-    console_print("[INFO] Processors: ");
-    console_print_hex(cpu_count());
-    console_print("\n[INFO] LAPIC Physical Address: ");
-    console_print_hex(cpu_lapic_get());
-    console_print("\n");
+    console_debug("[INFO] Processors: ");
+    console_debug_hex(cpu_count());
+    console_debug("\n[INFO] LAPIC Physical Address: ");
+    console_debug_hex(cpu_lapic_get());
+    console_debug("\n[INFO] I/O APICs: ");
+    console_debug_hex(cpu_ioapic_count());
+    console_debug("\n");
 
     // Initialize BSP
-    console_print("[SMP ] Initializing BSP...\n");
+    console_debug("[SMP ] Initializing BSP...\n");
     cpu_startup();
     
     // Initialize APs
-    console_print("[SMP ] Initializing APs...\n");
+    console_debug("[SMP ] Initializing APs...\n");
     cpu_smp_init();
     
     // Initialize system time
-    console_print("[CORE] Initializing system time...\n");
+    console_debug("[CORE] Initializing system time...\n");
     time_init();
     
-    console_print("[CORE] Done.");
+    // Turn boot context into the first thread
+    console_debug("[CORE] Initializing threads...\n");
+    thread_init();
+    
+    // Print boot time
+    console_print("[CORE] Done after ");
+    console_print_dec((intptr_t) (cpu_tsc_read() - boot_tsc));
+    console_print(" cycles.\n");
+    
+#ifdef __BENCHMARK__
+    // Run microbenchmarks
+    bench_run();
+#endif
+    
+    // Leave the BSP to its idle thread
+    thread_detach(thread_current());
+    thread_exit(0);
+    
     return 0;
 }
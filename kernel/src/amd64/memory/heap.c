@@ -23,6 +23,66 @@
 #include <api/sync/spinlock.h>
 #include <api/string.h>
 #include <api/debug/console.h>
+#include <amd64/memory/page.h>
+#include <amd64/cpu/tlb.h>
+
+//------------------------------------------------------------------------------
+// Heap - Constants
+//------------------------------------------------------------------------------
+
+/**
+ * The virtual address range large allocations are mapped into.
+ */
+#define HEAP_MMAP_BEGIN             0xFFFFFF4000000000
+#define HEAP_MMAP_END               0xFFFFFF7F00000000
+
+/**
+ * The maximum number of regions that can be mapped at the same time.
+ */
+#define HEAP_MMAP_REGIONS           256
+
+/**
+ * The amount of virtual address space reserved for a region of the given
+ * length, so the region can later grow in place.
+ */
+#define HEAP_MMAP_RESERVE(length)   mem_align((length) * 2, PAGE_LARGE_SIZE)
+
+/**
+ * The number of pages unmapped at once before their frames are freed after a
+ * TLB shootdown.
+ */
+#define HEAP_UNMAP_BATCH            128
+
+/**
+ * The flags to map the heap's pages with.
+ */
+#define HEAP_PAGE_FLAGS             (PG_PRESENT | PG_GLOBAL | PG_WRITABLE)
+
+//------------------------------------------------------------------------------
+// Heap - Structures
+//------------------------------------------------------------------------------
+
+/**
+ * A region of virtual memory mapped by <tt>heap_mmap</tt>.
+ */
+typedef struct heap_region_t
+{
+    /**
+     * The virtual address the region begins at.
+     */
+    uintptr_t begin;
+    
+    /**
+     * The number of bytes currently mapped.
+     */
+    size_t length;
+    
+    /**
+     * The number of bytes of address space reserved for the region.
+     */
+    size_t reserved;
+    
+} heap_region_t;
 
 //------------------------------------------------------------------------------
 // Heap - Variables
@@ -30,8 +90,25 @@
 
 uintptr_t heap_begin = 0xFFFFFF0080000000;
 uintptr_t heap_length = 0;
+
+/**
+ * The number of bytes mapped at the beginning of the heap.
+ *
+ * Grows in steps of large pages, so it is usually beyond the current break.
+ */
+static uintptr_t heap_mapped = 0;
 SPINLOCK_INIT(heap_lock);
 
+/**
+ * The regions currently mapped by <tt>heap_mmap</tt>, sorted by address.
+ */
+static heap_region_t heap_regions[HEAP_MMAP_REGIONS];
+
+/**
+ * The number of used entries in <tt>heap_regions</tt>.
+ */
+static size_t heap_region_count = 0;
+
 //------------------------------------------------------------------------------
 // Heap - Advanced
 //------------------------------------------------------------------------------
@@ -39,58 +116,343 @@ SPINLOCK_INIT(heap_lock);
 uint64_t heap_sbrk(intptr_t increase)
 {
     // Acquire lock
-    spinlock_acquire(&heap_lock);
+    heap_lock_acquire(&heap_lock);
+    
+    // Current break
+    uintptr_t brk = heap_begin + heap_length;
     
     // Increase?
     if (increase > 0) {
-        // Align
-        increase = mem_align((uintptr_t) increase, 0x1000);
-        
-        // Determine amount of pages
-        size_t pages = increase / 0x1000;
-        size_t i;
-        
-        for (i = 0; i < pages; ++i) {
-            // Allocate frame
-            uintptr_t phys = frame_alloc();
+        // Map memory until the new break is covered
+        while (heap_mapped < heap_length + increase) {
+            uintptr_t virt = heap_begin + heap_mapped;
+            uintptr_t phys;
             
-            // Map frame
-            page_map(
-                heap_begin + heap_length,
-                phys,
-                PG_PRESENT | PG_GLOBAL | PG_WRITABLE);
-                
-            // Increase length
-            heap_length += 0x1000;
+            // Try to grow by a large page
+            if (0 == (virt & (PAGE_LARGE_SIZE - 1))) {
+                phys = frame_alloc_contiguous(
+                    PAGE_LARGE_SIZE / PAGE_SIZE,
+                    PAGE_LARGE_SIZE);
+                    
+                if ((uintptr_t) -1 != phys) {
+                    page_map_large(virt, phys, HEAP_PAGE_FLAGS);
+                    heap_mapped += PAGE_LARGE_SIZE;
+                    continue;
+                }
+            }
+            
+            // Fall back to a single frame
+            phys = frame_alloc();
+            
+            if ((uintptr_t) -1 == phys) {
+                spinlock_release(&heap_lock);
+                return (uint64_t) -1;
+            }
+            
+            page_map(virt, phys, HEAP_PAGE_FLAGS);
+            heap_mapped += PAGE_SIZE;
         }
         
-    // Decrease
-    } else if (increase < 0) {
-        // Align decrease
-        uintptr_t decrease = mem_align((uintptr_t) (-increase), 0x1000);
+        // Increase length
+        heap_length += increase;
         
-        // Determine amount of pages
-        size_t pages = decrease / 0x1000;
+    // Decrease (memory stays mapped and is reused on the next increase)
+    } else if (increase < 0) {
+        if ((uintptr_t) (-increase) > heap_length)
+            heap_length = 0;
+        else
+            heap_length -= (uintptr_t) (-increase);
+    }
+    
+    // Release lock
+    spinlock_release(&heap_lock);
+    
+    // Previous break
+    return brk;
+}
+
+//------------------------------------------------------------------------------
+// Heap - Internal - Mappings
+//------------------------------------------------------------------------------
+
+/**
+ * Unmaps the pages in the given range and frees the frames backing them.
+ *
+ * @param begin The (page aligned) virtual address to begin at.
+ * @param end The (page aligned) virtual address to end at.
+ */
+static void _heap_unmap_range(uintptr_t begin, uintptr_t end)
+{
+    uintptr_t frames[HEAP_UNMAP_BATCH];
+    uintptr_t virt = begin;
+    
+    while (virt < end) {
+        size_t count = 0;
         size_t i;
         
-        for (i = 0; i < pages; ++i) {
-            // Get (virtual) begin address of last page
-            uintptr_t virt = heap_begin + heap_length;
-            
+        // Unmap a batch of pages
+        for (; virt < end && count < HEAP_UNMAP_BATCH; virt += 0x1000) {
             // Get physical address
             uintptr_t phys = page_get_physical(virt);
             
-            // Unmap page
+            if ((uintptr_t) -1 == phys)
+                continue;
+                
             page_unmap(virt);
+            frames[count++] = phys;
+        }
+        
+        if (0 == count)
+            break;
             
-            // Decrease length
-            heap_length -= 0x1000;
+        // Other CPUs may still hold translations to the frames
+        cpu_tlb_shootdown();
+        
+        for (i = 0; i < count; ++i)
+            frame_free(frames[i]);
+    }
+}
+
+/**
+ * Maps fresh frames to the pages in the given range.
+ *
+ * On failure all pages mapped by this call are unmapped again.
+ *
+ * @param begin The (page aligned) virtual address to begin at.
+ * @param end The (page aligned) virtual address to end at.
+ * @return Whether the range could be mapped.
+ */
+static bool _heap_map_range(uintptr_t begin, uintptr_t end)
+{
+    uintptr_t virt;
+    
+    for (virt = begin; virt < end; virt += 0x1000) {
+        // Allocate frame
+        uintptr_t phys = frame_alloc();
+        
+        // Out of memory?
+        if ((uintptr_t) -1 == phys) {
+            _heap_unmap_range(begin, virt);
+            return false;
         }
+        
+        // Map frame
+        page_map(virt, phys, HEAP_PAGE_FLAGS);
     }
     
+    return true;
+}
+
+/**
+ * Returns the index of the region beginning at the given address.
+ *
+ * @param begin The address the region begins at.
+ * @return The index of the region or <tt>heap_region_count</tt>, if there is
+ *  no such region.
+ */
+static size_t _heap_region_find(uintptr_t begin)
+{
+    size_t i;
+    
+    for (i = 0; i < heap_region_count; ++i)
+        if (heap_regions[i].begin == begin)
+            break;
+            
+    return i;
+}
+
+/**
+ * Removes the region at the given index from the region table.
+ *
+ * @param index The index of the region to remove.
+ */
+static void _heap_region_remove(size_t index)
+{
+    --heap_region_count;
+    
+    for (; index < heap_region_count; ++index)
+        heap_regions[index] = heap_regions[index + 1];
+}
+
+/**
+ * Returns the address the region at the given index may grow up to.
+ *
+ * @param index The index of the region.
+ * @return The begin of the next region or the end of the mapping area.
+ */
+static uintptr_t _heap_region_limit(size_t index)
+{
+    if (index + 1 < heap_region_count)
+        return heap_regions[index + 1].begin;
+    
+    return HEAP_MMAP_END;
+}
+
+//------------------------------------------------------------------------------
+// Heap - Mappings
+//------------------------------------------------------------------------------
+
+void *heap_mmap(size_t length)
+{
+    // Align length and determine reservation
+    length = mem_align(length, 0x1000);
+    size_t reserved = HEAP_MMAP_RESERVE(length);
+    
+    // Acquire lock
+    heap_lock_acquire(&heap_lock);
+    
+    // Region table full?
+    if (HEAP_MMAP_REGIONS == heap_region_count)
+        goto fail;
+    
+    // Find first gap that is large enough for the reservation
+    uintptr_t begin = HEAP_MMAP_BEGIN;
+    size_t index;
+    
+    for (index = 0; index < heap_region_count; ++index) {
+        if (heap_regions[index].begin - begin >= reserved)
+            break;
+        
+        begin = heap_regions[index].begin + heap_regions[index].reserved;
+    }
+    
+    // Out of address space?
+    if (HEAP_MMAP_END - begin < reserved)
+        goto fail;
+        
+    // Map memory
+    if (!_heap_map_range(begin, begin + length))
+        goto fail;
+        
+    // Insert region
+    size_t i;
+    
+    for (i = heap_region_count; i > index; --i)
+        heap_regions[i] = heap_regions[i - 1];
+        
+    heap_regions[index].begin = begin;
+    heap_regions[index].length = length;
+    heap_regions[index].reserved = reserved;
+    ++heap_region_count;
+    
+    // Release lock
+    spinlock_release(&heap_lock);
+    
+    return (void *) begin;
+    
+fail:
+    spinlock_release(&heap_lock);
+    return (void *) -1;
+}
+
+int heap_munmap(void *addr, size_t length)
+{
+    // Range to unmap
+    uintptr_t begin = (uintptr_t) addr;
+    uintptr_t end = begin + mem_align(length, 0x1000);
+    
+    // Acquire lock
+    heap_lock_acquire(&heap_lock);
+    
+    // Unmap pages
+    _heap_unmap_range(begin, end);
+    
+    // Update the affected regions (possibly more than one, as dlmalloc merges
+    // adjacent mappings)
+    size_t i = 0;
+    
+    while (i < heap_region_count) {
+        heap_region_t *region = &heap_regions[i];
+        uintptr_t region_end = region->begin + region->length;
+        
+        // Not affected?
+        if (end <= region->begin || begin >= region_end) {
+            ++i;
+            continue;
+        }
+        
+        // Completely unmapped?
+        if (begin <= region->begin && end >= region_end) {
+            _heap_region_remove(i);
+            continue;
+        }
+        
+        // Tail unmapped?
+        if (begin > region->begin)
+            region->length = begin - region->begin;
+        
+        // Head unmapped
+        else {
+            region->length = region_end - end;
+            region->reserved -= end - region->begin;
+            region->begin = end;
+        }
+        
+        ++i;
+    }
+    
+    // Release lock
+    spinlock_release(&heap_lock);
+    
+    return 0;
+}
+
+void *heap_mremap(void *addr, size_t old_length, size_t new_length, int flags)
+{
+    // Acquire lock
+    heap_lock_acquire(&heap_lock);
+    
+    // Find region
+    size_t index = _heap_region_find((uintptr_t) addr);
+    
+    if (index == heap_region_count)
+        goto fail;
+        
+    heap_region_t *region = &heap_regions[index];
+    new_length = mem_align(new_length, 0x1000);
+    
+    // Grow?
+    if (new_length > region->length) {
+        // Exceeds the space until the next region?
+        if (region->begin + new_length > _heap_region_limit(index))
+            goto fail;
+            
+        // Map additional pages in place
+        if (!_heap_map_range(
+            region->begin + region->length,
+            region->begin + new_length))
+            goto fail;
+            
+        // Extend reservation
+        if (new_length > region->reserved)
+            region->reserved = new_length;
+            
+    // Shrink?
+    } else if (new_length < region->length)
+        _heap_unmap_range(
+            region->begin + new_length,
+            region->begin + region->length);
+            
+    region->length = new_length;
+    
     // Release lock
     spinlock_release(&heap_lock);
     
-    // Beginning of the heap
-    return heap_begin;
+    return addr;
+    
+fail:
+    spinlock_release(&heap_lock);
+    return (void *) -1;
+}
+
+//------------------------------------------------------------------------------
+// Heap - Locking
+//------------------------------------------------------------------------------
+
+void heap_lock_acquire(spinlock_t *lock)
+{
+    while (!spinlock_try_acquire(lock)) {
+        cpu_tlb_poll();
+        asm volatile ("pause");
+    }
 }
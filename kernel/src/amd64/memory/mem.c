@@ -0,0 +1,268 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+
+#include <api/types.h>
+#include <api/string.h>
+
+#include <amd64/cpu/features.h>
+
+//----------------------------------------------------------------------------//
+// Internal - Constants
+//----------------------------------------------------------------------------//
+
+/**
+ * Minimum length for which <tt>rep movsb</tt> / <tt>rep stosb</tt> are used on
+ * processors with ERMS but without fast short string support.
+ */
+#define MEM_ERMS_THRESHOLD 128
+
+//----------------------------------------------------------------------------//
+// Internal - Copying
+//----------------------------------------------------------------------------//
+
+/**
+ * Copies <tt>length</tt> bytes forwards using <tt>rep movsb</tt>.
+ *
+ * @param dest The destination in memory.
+ * @param src The source in memory.
+ * @param length The number of bytes to copy.
+ */
+static void _mem_copy_bytes(void *dest, const void *src, size_t length)
+{
+    asm volatile (
+        "rep movsb"
+        : "+D" (dest), "+S" (src), "+c" (length)
+        :
+        : "memory");
+}
+
+/**
+ * Copies <tt>length</tt> bytes forwards, aligning the destination to eight
+ * bytes and moving the bulk using <tt>rep movsq</tt>.
+ *
+ * @param dest The destination in memory.
+ * @param src The source in memory.
+ * @param length The number of bytes to copy.
+ */
+static void _mem_copy_quads(void *dest, const void *src, size_t length)
+{
+    // Short copies are not worth the setup
+    if (length < 16) {
+        _mem_copy_bytes(dest, src, length);
+        return;
+    }
+    
+    // Align destination
+    size_t head = (8 - ((uintptr_t) dest & 7)) & 7;
+    size_t quads = (length - head) >> 3;
+    size_t tail = (length - head) & 7;
+    
+    asm volatile (
+        "rep movsb\n"
+        "mov %3, %%rcx\n"
+        "rep movsq\n"
+        "mov %4, %%rcx\n"
+        "rep movsb"
+        : "+D" (dest), "+S" (src), "+c" (head)
+        : "r" (quads), "r" (tail)
+        : "memory");
+}
+
+/**
+ * Copies <tt>length</tt> bytes forwards on processors with ERMS, falling back
+ * to quad-words for short copies with high startup overhead.
+ *
+ * @param dest The destination in memory.
+ * @param src The source in memory.
+ * @param length The number of bytes to copy.
+ */
+static void _mem_copy_erms(void *dest, const void *src, size_t length)
+{
+    if (length < MEM_ERMS_THRESHOLD)
+        _mem_copy_quads(dest, src, length);
+    else
+        _mem_copy_bytes(dest, src, length);
+}
+
+/**
+ * Copies <tt>length</tt> bytes backwards, beginning at the last byte.
+ *
+ * Used for overlapping moves where the destination is above the source.
+ *
+ * @param dest The destination in memory.
+ * @param src The source in memory.
+ * @param length The number of bytes to copy.
+ */
+static void _mem_copy_backwards(void *dest, const void *src, size_t length)
+{
+    uint8_t *d = (uint8_t *) dest + length;
+    const uint8_t *s = (const uint8_t *) src + length;
+    
+    // Copy trailing bytes until the end of the destination is aligned
+    while (length > 0 && 0 != ((uintptr_t) d & 7)) {
+        *--d = *--s;
+        --length;
+    }
+    
+    // Copy quad-words backwards
+    size_t quads = length >> 3;
+    length &= 7;
+    
+    if (quads > 0) {
+        // Start at the last quad-word; the string operation stops one
+        // quad-word below the last one copied
+        uint8_t *dq = d - 8;
+        const uint8_t *sq = s - 8;
+        
+        asm volatile (
+            "std\n"
+            "rep movsq\n"
+            "cld"
+            : "+D" (dq), "+S" (sq), "+c" (quads)
+            :
+            : "memory");
+        
+        d = dq + 8;
+        s = sq + 8;
+    }
+    
+    // Copy remaining leading bytes
+    while (length-- > 0)
+        *--d = *--s;
+}
+
+//----------------------------------------------------------------------------//
+// Internal - Setting
+//----------------------------------------------------------------------------//
+
+/**
+ * Fills <tt>length</tt> bytes using <tt>rep stosb</tt>.
+ *
+ * @param dest The destination in memory.
+ * @param c The byte to fill with.
+ * @param length The number of bytes to fill.
+ */
+static void _mem_set_bytes(void *dest, uint8_t c, size_t length)
+{
+    asm volatile (
+        "rep stosb"
+        : "+D" (dest), "+c" (length)
+        : "a" (c)
+        : "memory");
+}
+
+/**
+ * Fills <tt>length</tt> bytes, aligning the destination to eight bytes and
+ * filling the bulk using <tt>rep stosq</tt>.
+ *
+ * @param dest The destination in memory.
+ * @param c The byte to fill with.
+ * @param length The number of bytes to fill.
+ */
+static void _mem_set_quads(void *dest, uint8_t c, size_t length)
+{
+    // Short fills are not worth the setup
+    if (length < 16) {
+        _mem_set_bytes(dest, c, length);
+        return;
+    }
+    
+    // Replicate byte over a quad-word
+    uint64_t pattern = 0x0101010101010101ULL * c;
+    
+    // Align destination
+    size_t head = (8 - ((uintptr_t) dest & 7)) & 7;
+    size_t quads = (length - head) >> 3;
+    size_t tail = (length - head) & 7;
+    
+    asm volatile (
+        "rep stosb\n"
+        "mov %3, %%rcx\n"
+        "rep stosq\n"
+        "mov %4, %%rcx\n"
+        "rep stosb"
+        : "+D" (dest), "+c" (head)
+        : "a" (pattern), "r" (quads), "r" (tail)
+        : "memory");
+}
+
+/**
+ * Fills <tt>length</tt> bytes on processors with ERMS, falling back to
+ * quad-words for short fills with high startup overhead.
+ *
+ * @param dest The destination in memory.
+ * @param c The byte to fill with.
+ * @param length The number of bytes to fill.
+ */
+static void _mem_set_erms(void *dest, uint8_t c, size_t length)
+{
+    if (length < MEM_ERMS_THRESHOLD)
+        _mem_set_quads(dest, c, length);
+    else
+        _mem_set_bytes(dest, c, length);
+}
+
+//----------------------------------------------------------------------------//
+// Variables
+//----------------------------------------------------------------------------//
+
+/**
+ * Selected forward copy implementation.
+ */
+static void (*mem_copy_impl)(void *, const void *, size_t) = &_mem_copy_quads;
+
+/**
+ * Selected fill implementation.
+ */
+static void (*mem_set_impl)(void *, uint8_t, size_t) = &_mem_set_quads;
+
+//----------------------------------------------------------------------------//
+// Alternatives
+//----------------------------------------------------------------------------//
+
+// Aligned quad-words are the fallback; see the initializers above
+CPU_ALTERNATIVE(mem_copy_impl, CPU_FEATURE_ERMS, 1, _mem_copy_erms);
+CPU_ALTERNATIVE(mem_copy_impl, CPU_FEATURE_FSRM, 2, _mem_copy_bytes);
+CPU_ALTERNATIVE(mem_set_impl, CPU_FEATURE_ERMS, 1, _mem_set_erms);
+
+
+//----------------------------------------------------------------------------//
+// Memory Utilities
+//----------------------------------------------------------------------------//
+
+void memcpy(void *dest, void *src, size_t length)
+{
+    mem_copy_impl(dest, src, length);
+}
+
+void memmove(void *dest, void *src, size_t length)
+{
+    // Forward copy is safe if the destination is below the source or the
+    // chunks do not overlap
+    if ((uintptr_t) dest <= (uintptr_t) src ||
+        (uintptr_t) dest >= (uintptr_t) src + length)
+        mem_copy_impl(dest, src, length);
+    else
+        _mem_copy_backwards(dest, src, length);
+}
+
+void memset(void *dest, uint8_t c, size_t length)
+{
+    mem_set_impl(dest, c, length);
+}
@@ -45,6 +45,9 @@ static uintptr_t page_kernel_pml4;
 #define PAGE_KERNEL_BEGIN           0xFFFFFF0000000000
 #define PAGE_KERNEL_END             0xFFFFFF8000000000
 #define PAGE_AUX                    (PAGE_KERNEL_END - PAGE_SIZE * 0x10)
+#define PAGE_AUX_SLOT(i)            (PAGE_AUX + PAGE_SIZE * i)
+#define PAGE_AUX_DEST               PAGE_AUX_SLOT(1)
+#define PAGE_AUX_SRC                PAGE_AUX_SLOT(2)
                                             
 #define PAGE_GET_PHYS(page)         mem_align(page, PAGE_SIZE)
 
@@ -63,7 +66,7 @@ static uintptr_t page_kernel_pml4;
  */
 static void _page_do_invalidate(uintptr_t virt)
 {
-	asm volatile ("invlpg %0" :: "m" (virt));
+	asm volatile ("invlpg (%0)" :: "r" (virt) : "memory");
 }
 
 /**
@@ -106,6 +109,61 @@ static void _page_invalidate(uintptr_t virt)
 	}*/
 }
 
+/**
+ * Zeroes the page at the given virtual address using non-temporal stores.
+ *
+ * @param virt The (page aligned) virtual address of the page to zero.
+ */
+static void _page_zero(uintptr_t virt)
+{
+    size_t count = PAGE_SIZE / 32;
+    
+    asm volatile (
+        "1:\n"
+        "movnti %2, 0(%0)\n"
+        "movnti %2, 8(%0)\n"
+        "movnti %2, 16(%0)\n"
+        "movnti %2, 24(%0)\n"
+        "add $32, %0\n"
+        "dec %1\n"
+        "jnz 1b\n"
+        "sfence"
+        : "+r" (virt), "+r" (count)
+        : "r" ((uint64_t) 0)
+        : "memory", "cc");
+}
+
+/**
+ * Copies the page at the given virtual address to another one using
+ * non-temporal stores.
+ *
+ * @param dest The (page aligned) virtual address of the destination page.
+ * @param src The (page aligned) virtual address of the source page.
+ */
+static void _page_copy(uintptr_t dest, uintptr_t src)
+{
+    size_t count = PAGE_SIZE / 32;
+    
+    asm volatile (
+        "1:\n"
+        "mov 0(%1), %%r8\n"
+        "mov 8(%1), %%r9\n"
+        "mov 16(%1), %%r10\n"
+        "mov 24(%1), %%r11\n"
+        "movnti %%r8, 0(%0)\n"
+        "movnti %%r9, 8(%0)\n"
+        "movnti %%r10, 16(%0)\n"
+        "movnti %%r11, 24(%0)\n"
+        "add $32, %0\n"
+        "add $32, %1\n"
+        "dec %2\n"
+        "jnz 1b\n"
+        "sfence"
+        : "+r" (dest), "+r" (src), "+r" (count)
+        :
+        : "r8", "r9", "r10", "r11", "memory", "cc");
+}
+
 /**
  * Maps given page to the given physical address and sets the given flags.
  *
@@ -129,11 +187,12 @@ static void _page_unmap(page_t *page)
 }
 
 /**
- * Allocates a new frame and maps the given page to it.
+ * Allocates a new frame for a paging structure, maps the given page to it and
+ * clears the structure.
  *
  * @param page The page to map.
  * @param flags The flags to map the flags with.
- * @param virt The virtual address to invalidate.
+ * @param virt The virtual address the structure is accessible at.
  */
 static void _page_alloc_frame(page_t *page, uint16_t flags, uintptr_t virt)
 {
@@ -141,17 +200,20 @@ static void _page_alloc_frame(page_t *page, uint16_t flags, uintptr_t virt)
     uintptr_t frame = frame_alloc();
     _page_map(page, frame, flags);
     _page_invalidate(virt);
+    
+    // Clear the new structure
+    _page_zero(virt);
 }
 
 /**
- * Checks whether the page for the given virtual address exists in the current
- * address space.
+ * Checks whether the page directory for the given virtual address exists in the
+ * current address space.
  *
- * @param virt The virtual address that belongs to the page to create.
- * @param create Whether to create the page, if it does not exist.
- * @return Returns whether the page exists now.
+ * @param virt The virtual address that belongs to the page directory.
+ * @param create Whether to create the page directory, if it does not exist.
+ * @return Returns whether the page directory exists now.
  */
-static bool _page_exists(uintptr_t virt, bool create)
+static bool _page_exists_pd(uintptr_t virt, bool create)
 {
     // PML4E
     page_t *pml4e = (page_t *) PAGE_VIRT_PML4E(PAGE_PML4E_INDEX(virt));
@@ -182,6 +244,24 @@ static bool _page_exists(uintptr_t virt, bool create)
         else
             return false;
     }
+    
+    // Exists
+    return true;
+}
+
+/**
+ * Checks whether the page for the given virtual address exists in the current
+ * address space.
+ *
+ * @param virt The virtual address that belongs to the page to create.
+ * @param create Whether to create the page, if it does not exist.
+ * @return Returns whether the page exists now.
+ */
+static bool _page_exists(uintptr_t virt, bool create)
+{
+    // PML4E and PDPE
+    if (!_page_exists_pd(virt, create))
+        return false;
         
     // PDE
     page_t *pde = (page_t *) PAGE_VIRT_PDE(
@@ -206,6 +286,57 @@ static bool _page_exists(uintptr_t virt, bool create)
     return true;
 }
 
+/**
+ * Returns the large page mapping the given virtual address, if any.
+ *
+ * @param virt The virtual address.
+ * @return Pointer to the PDE of the large page or a null-pointer, if the
+ *  address is not mapped by a large page.
+ */
+static page_t *_page_get_large(uintptr_t virt)
+{
+    // Page directory exists?
+    if (!_page_exists_pd(virt, false))
+        return 0;
+        
+    // Present and large?
+    page_t *pde = (page_t *) PAGE_VIRT_PDE(
+        PAGE_PML4E_INDEX(virt),
+        PAGE_PDPE_INDEX(virt),
+        PAGE_PDE_INDEX(virt));
+        
+    if ((*pde & PG_PRESENT) && (*pde & PG_LARGE))
+        return pde;
+        
+    return 0;
+}
+
+/**
+ * Maps the given auxiliary page to the given physical address.
+ *
+ * The page lock must be held while the auxiliary page is in use.
+ *
+ * @param aux The virtual address of the auxiliary page.
+ * @param phys The physical address to map to.
+ */
+static void _page_aux_map(uintptr_t aux, uintptr_t phys)
+{
+    _page_exists(aux, true);
+    _page_map((page_t *) PAGE_VIRT_PAGE(aux), phys, PAGE_FLAGS_AUX);
+    _page_do_invalidate(aux);
+}
+
+/**
+ * Unmaps the given auxiliary page.
+ *
+ * @param aux The virtual address of the auxiliary page.
+ */
+static void _page_aux_unmap(uintptr_t aux)
+{
+    _page_unmap((page_t *) PAGE_VIRT_PAGE(aux));
+    _page_do_invalidate(aux);
+}
+
 /**
  * Internal function for switching the address space, that does not aquire the
  * page lock and performs no integrity checks.
@@ -268,13 +399,51 @@ void page_map(uintptr_t virt, uintptr_t phys, uint16_t flags)
     spinlock_release(&page_lock);
 }
 
+void page_map_large(uintptr_t virt, uintptr_t phys, uint16_t flags)
+{
+    // Acquire lock
+    spinlock_acquire(&page_lock);
+    
+    // Create the page directory (if it does not already exist)
+    _page_exists_pd(virt, true);
+    
+    // Get PDE
+    page_t *pde = (page_t *) PAGE_VIRT_PDE(
+        PAGE_PML4E_INDEX(virt),
+        PAGE_PDPE_INDEX(virt),
+        PAGE_PDE_INDEX(virt));
+        
+    // Release page table that is replaced by the large page
+    if ((*pde & PG_PRESENT) && !(*pde & PG_LARGE))
+        frame_free(*pde & ~(PAGE_SIZE - 1));
+        
+    // Map large page
+    *pde = (phys & ~(PAGE_LARGE_SIZE - 1)) | flags | PG_PRESENT | PG_LARGE;
+    
+    // Invalidate TLB entry
+    _page_invalidate(virt);
+    
+    // Release lock
+    spinlock_release(&page_lock);
+}
+
 void page_unmap(uintptr_t virt)
 {
     // Acquire lock
     spinlock_acquire(&page_lock);
     
+    // Mapped by large page?
+    page_t *large = _page_get_large(virt);
+    
+    if (0 != large) {
+        // Remove present flag
+        _page_unmap(large);
+        
+        // Invalidate TLB
+        _page_invalidate(virt);
+        
     // Check if the page exists
-    if (_page_exists(virt, false)) {
+    } else if (_page_exists(virt, false)) {
         // Remove present flag
         _page_unmap((page_t *) (PAGE_VIRT_PAGE(virt)));
 	
@@ -303,8 +472,14 @@ uintptr_t page_get_physical(uintptr_t virt)
     
     // Check if page exists
     uintptr_t phys = (uintptr_t) -1;
+    page_t *large = _page_get_large(virt);
     
-    if (_page_exists(virt, false)) {
+    if (0 != large) {
+        // Align (down) large page value and add offset
+        phys = *large & ~(PAGE_LARGE_SIZE - 1);
+        phys += virt & (PAGE_LARGE_SIZE - 1);
+        
+    } else if (_page_exists(virt, false)) {
         // Align (down) page value
         phys = *((page_t *) PAGE_VIRT_PAGE(virt));
         phys &= ~0xFFF;
@@ -319,6 +494,40 @@ uintptr_t page_get_physical(uintptr_t virt)
     return phys;
 }
 
+//----------------------------------------------------------------------------//
+// Page - Frame Contents
+//----------------------------------------------------------------------------//
+
+void page_zero(uintptr_t phys)
+{
+    // Acquire lock
+    spinlock_acquire(&page_lock);
+    
+    // Zero frame through AUX page
+    _page_aux_map(PAGE_AUX_DEST, phys);
+    _page_zero(PAGE_AUX_DEST);
+    _page_aux_unmap(PAGE_AUX_DEST);
+    
+    // Release lock
+    spinlock_release(&page_lock);
+}
+
+void page_copy(uintptr_t dest, uintptr_t src)
+{
+    // Acquire lock
+    spinlock_acquire(&page_lock);
+    
+    // Copy frame through AUX pages
+    _page_aux_map(PAGE_AUX_DEST, dest);
+    _page_aux_map(PAGE_AUX_SRC, src);
+    _page_copy(PAGE_AUX_DEST, PAGE_AUX_SRC);
+    _page_aux_unmap(PAGE_AUX_SRC);
+    _page_aux_unmap(PAGE_AUX_DEST);
+    
+    // Release lock
+    spinlock_release(&page_lock);
+}
+
 //----------------------------------------------------------------------------//
 // Page - Address Space
 //----------------------------------------------------------------------------//
@@ -409,10 +618,9 @@ uintptr_t page_create_space()
     // Create PML4 frame
     uintptr_t newPml4 = frame_alloc();
     
-    // Map in PML4 into AUX page
-    page_t *auxPage = (page_t *) PAGE_VIRT_PAGE(PAGE_AUX);
-    _page_map(auxPage, newPml4, PAGE_FLAGS_AUX);
-	_page_do_invalidate(PAGE_AUX);
+    // Map in PML4 into AUX page and clear it
+    _page_aux_map(PAGE_AUX, newPml4);
+    _page_zero(PAGE_AUX);
     
     // Setup kernel mapping
     page_t *kernelPdpEntry = (page_t *) (PAGE_AUX + 8 * 510);
@@ -423,9 +631,10 @@ uintptr_t page_create_space()
     _page_map(recPdpEntry, newPml4, PAGE_FLAGS_RECURSIVE);
     
     // Unmap AUX
-    *auxPage &= ~PG_PRESENT;
-	_page_do_invalidate(PAGE_AUX);
+    _page_aux_unmap(PAGE_AUX);
     
     // Release lock
     spinlock_release(&page_lock);
+    
+    return newPml4;
 }
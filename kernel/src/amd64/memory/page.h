@@ -23,6 +23,7 @@
 //----------------------------------------------------------------------------//
 
 #define PAGE_SIZE                   0x1000
+#define PAGE_LARGE_SIZE             0x200000
 
 #define PAGE_PML4E_INDEX(a)         ((a >> 39) & 0x1FF)
 #define PAGE_PDPE_INDEX(a)          ((a >> 30) & 0x1FF)
@@ -67,3 +68,20 @@ void page_init(uintptr_t virt, uintptr_t phys);
  * Unmaps the low memory when its not required any longer.
  */
 void page_unmap_low();
+
+//----------------------------------------------------------------------------//
+// Large Pages
+//----------------------------------------------------------------------------//
+
+/**
+ * Maps the 2 MiB large page at the given virtual address to the given physical
+ * address and sets the given flags in addition to the present flag.
+ *
+ * If the range has been mapped using a page table before, all pages in that
+ * table must already be unmapped; the table is released.
+ *
+ * @param virt The (2 MiB aligned) virtual address to map.
+ * @param phys The (2 MiB aligned) physical address to map to.
+ * @param flags The flags (except the present flag) to set.
+ */
+void page_map_large(uintptr_t virt, uintptr_t phys, uint16_t flags);
@@ -0,0 +1,65 @@
+; Oxygen Operating System
+; Copyright (C) 2010 Lukas Heidemann
+;
+; This program is free software: you can redistribute it and/or modify
+; it under the terms of the GNU General Public License as published by
+; the Free Software Foundation, either version 3 of the License, or
+; (at your option) any later version.
+;
+; This program is distributed in the hope that it will be useful,
+; but WITHOUT ANY WARRANTY; without even the implied warranty of
+; MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+; GNU General Public License for more details.
+;
+; You should have received a copy of the GNU General Public License
+; along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+[BITS 64]
+
+;-------------------------------------------------------------------------------
+; Context Switch
+;-------------------------------------------------------------------------------
+
+; Starts a new thread in C code
+[EXTERN thread_start]
+
+; Switches from the thread in rdi to the thread in rsi and returns the former
+; in rax. Only the callee-saved registers need to be kept, as the switch is a
+; function call for both threads; the saved stack pointer is the first field
+; of the thread structure.
+[GLOBAL thread_context_switch]
+thread_context_switch:
+    push rbp
+    push rbx
+    push r12
+    push r13
+    push r14
+    push r15
+    
+    mov [rdi], rsp          ; Save the previous thread's stack
+    mov rsp, [rsi]          ; Load the next thread's stack
+    mov rax, rdi            ; Return the previous thread
+    
+    pop r15
+    pop r14
+    pop r13
+    pop r12
+    pop rbx
+    pop rbp
+    ret
+    
+; First code run by a new thread, returned to from thread_context_switch
+; with an aligned stack. The entry point and its argument have been popped
+; into r12 and r13.
+[GLOBAL thread_context_start]
+thread_context_start:
+    mov rdi, rax            ; Previous thread
+    mov rsi, r12            ; Entry point
+    mov rdx, r13            ; Argument
+    
+    mov rax, thread_start
+    call rax                ; Does not return
+    
+.hang:
+    hlt
+    jmp .hang
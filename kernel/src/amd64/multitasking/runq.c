@@ -0,0 +1,71 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+
+#include <api/types.h>
+#include <api/multitasking/thread.h>
+
+#include <amd64/multitasking/runq.h>
+
+//----------------------------------------------------------------------------//
+// Run Queue
+//----------------------------------------------------------------------------//
+
+bool thread_runq_push(thread_runq_t *runq, thread_t *thread)
+{
+    uint64_t bottom = runq->bottom;
+    
+    // Full?
+    if (bottom - runq->top >= THREAD_RUNQ_SIZE)
+        return false;
+        
+    runq->slots[bottom % THREAD_RUNQ_SIZE] = thread;
+    
+    // Publish the slot before the new bottom (stores are not reordered)
+    asm volatile ("" ::: "memory");
+    runq->bottom = bottom + 1;
+    
+    return true;
+}
+
+thread_t *thread_runq_take(thread_runq_t *runq)
+{
+    while (1) {
+        uint64_t top = runq->top;
+        
+        // Read top before bottom (loads are not reordered)
+        asm volatile ("" ::: "memory");
+        uint64_t bottom = runq->bottom;
+        
+        // Empty?
+        if (top >= bottom)
+            return 0;
+            
+        // Claim the slot; its thread can not have been overwritten unless
+        // another CPU took it, which makes the swap fail
+        thread_t *thread = runq->slots[top % THREAD_RUNQ_SIZE];
+        
+        if (__sync_bool_compare_and_swap(&runq->top, top, top + 1))
+            return thread;
+    }
+}
+
+bool thread_runq_empty(thread_runq_t *runq)
+{
+    return runq->top >= runq->bottom;
+}
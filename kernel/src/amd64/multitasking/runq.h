@@ -0,0 +1,95 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+#pragma once
+#include <api/types.h>
+#include <api/compiler.h>
+#include <api/multitasking/thread.h>
+
+//----------------------------------------------------------------------------//
+// Run Queue - Constants
+//----------------------------------------------------------------------------//
+
+/**
+ * Number of threads a run queue can hold (power of two).
+ */
+#define THREAD_RUNQ_SIZE            256
+
+//----------------------------------------------------------------------------//
+// Run Queue - Structures
+//----------------------------------------------------------------------------//
+
+/**
+ * A CPU's lock-free run queue.
+ *
+ * Works like a Chase-Lev deque of which only the stealing end is used for
+ * taking threads: only the owning CPU pushes threads at the bottom, while
+ * the owner and other CPUs take them from the top with a compare-and-swap,
+ * so threads run in FIFO order.
+ */
+typedef struct thread_runq_t
+{
+    /**
+     * Index of the next thread to take; changed by any CPU.
+     */
+    volatile uint64_t top ALIGNED(CACHE_LINE_SIZE);
+    
+    /**
+     * Index of the next free slot; only changed by the owner.
+     */
+    volatile uint64_t bottom ALIGNED(CACHE_LINE_SIZE);
+    
+    /**
+     * Ring buffer of queued threads.
+     */
+    thread_t * volatile slots[THREAD_RUNQ_SIZE];
+    
+} thread_runq_t;
+
+//----------------------------------------------------------------------------//
+// Run Queue
+//----------------------------------------------------------------------------//
+
+/**
+ * Appends a thread to the given run queue.
+ *
+ * Must only be called by the CPU owning the queue, with interrupts disabled.
+ *
+ * @param runq The run queue.
+ * @param thread The thread to push.
+ * @return Whether there was space left in the queue.
+ */
+bool thread_runq_push(thread_runq_t *runq, thread_t *thread);
+
+/**
+ * Takes the oldest thread from the given run queue.
+ *
+ * May be called by any CPU.
+ *
+ * @param runq The run queue.
+ * @return The thread or a null-pointer, if the queue is empty.
+ */
+thread_t *thread_runq_take(thread_runq_t *runq);
+
+/**
+ * Returns whether the given run queue is (momentarily) empty.
+ *
+ * @param runq The run queue.
+ * @return Whether the queue is empty.
+ */
+bool thread_runq_empty(thread_runq_t *runq);
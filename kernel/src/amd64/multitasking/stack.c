@@ -45,7 +45,7 @@ size_t stack_resize(size_t size, stack_t *stack)
         // Free pages
         uintptr_t virt = stack->addr - stack->size;
         for (; virt < stack->addr - size; virt += 0x1000) {
-            uintptr_t phys = page_get_phys(virt);
+            uintptr_t phys = page_get_physical(virt);
             page_unmap(virt);
             frame_free(phys);
         }
@@ -0,0 +1,683 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+
+#include <api/types.h>
+#include <api/string.h>
+#include <api/cpu.h>
+
+#include <api/cpu/int.h>
+#include <api/cpu/timer.h>
+
+#include <api/memory/heap.h>
+
+#include <api/multitasking/thread.h>
+
+#include <api/sync/spinlock.h>
+
+#include <amd64/cpu/defer.h>
+#include <amd64/cpu/fpu.h>
+#include <amd64/cpu/idle.h>
+#include <amd64/cpu/percpu.h>
+#include <amd64/cpu/topology.h>
+#include <amd64/multitasking/runq.h>
+#include <amd64/multitasking/thread.h>
+
+//----------------------------------------------------------------------------//
+// Thread - Structures
+//----------------------------------------------------------------------------//
+
+/**
+ * Scheduling state of a CPU.
+ */
+typedef struct thread_cpu_t
+{
+    /**
+     * The CPU's run queue.
+     */
+    thread_runq_t runq;
+    
+    /**
+     * Logical numbers of the CPUs to steal threads from, closest first.
+     */
+    uint16_t victims[MAX_CPUS];
+    volatile size_t victim_count;
+    
+    /**
+     * Timer ending time slices; only armed while a thread other than the
+     * idle thread runs.
+     */
+    cpu_timer_t slice;
+    
+} thread_cpu_t;
+
+//----------------------------------------------------------------------------//
+// Thread - Variables
+//----------------------------------------------------------------------------//
+
+/**
+ * The thread running on the current CPU and the CPU's idle thread.
+ */
+PERCPU thread_t *thread_percpu_current = 0;
+PERCPU thread_t *thread_percpu_idle = 0;
+
+/**
+ * Whether the current thread's time slice is over.
+ */
+PERCPU bool thread_percpu_resched = false;
+
+/**
+ * Scheduling state per CPU, indexed by the CPU's logical number.
+ */
+static thread_cpu_t _thread_cpus[MAX_CPUS];
+
+/**
+ * Queue of ready threads that did not fit into their CPU's run queue.
+ */
+static thread_t * volatile _thread_overflow_head = 0;
+static thread_t *_thread_overflow_tail = 0;
+static SPINLOCK_INIT(_thread_overflow_lock);
+
+/**
+ * Released threads kept with their stacks for reuse.
+ */
+static thread_t *_thread_pool = 0;
+static size_t _thread_pool_count = 0;
+static SPINLOCK_INIT(_thread_pool_lock);
+
+/**
+ * The id of the next thread to create.
+ */
+static volatile thread_id_t _thread_next_id = 1;
+
+//----------------------------------------------------------------------------//
+// Thread - Internal - Pool
+//----------------------------------------------------------------------------//
+
+/**
+ * Allocates a thread with a stack, preferably from the pool.
+ *
+ * @return The thread.
+ */
+static thread_t *_thread_alloc(void)
+{
+    // Reuse a released thread?
+    spinlock_acquire(&_thread_pool_lock);
+    
+    thread_t *thread = _thread_pool;
+    
+    if (0 != thread) {
+        _thread_pool = thread->next;
+        --_thread_pool_count;
+    }
+    
+    spinlock_release(&_thread_pool_lock);
+    
+    // Allocate a new one
+    if (0 == thread) {
+        thread = (thread_t *) malloc(sizeof(thread_t));
+        thread->fpu = 0;
+        thread->stack.size = THREAD_STACK_SIZE;
+        thread->stack.addr =
+            (uintptr_t) malloc(THREAD_STACK_SIZE) + THREAD_STACK_SIZE;
+    }
+    
+    // Reset
+    thread->id = __sync_fetch_and_add(&_thread_next_id, 1);
+    thread->state = THREAD_STATE_READY;
+    thread->flags = 0;
+    thread->on_cpu = false;
+    thread->fpu_cpu = FPU_CPU_NONE;
+    thread->lock.lock = 0;
+    thread->lock.flags = 0;
+    thread->result = 0;
+    thread->joiner = 0;
+    thread->next = 0;
+    
+    return thread;
+}
+
+/**
+ * Releases a thread that is not running anymore into the pool, or frees it if
+ * the pool is full.
+ *
+ * @param thread The thread to release.
+ */
+static void _thread_free(thread_t *thread)
+{
+    // Boot contexts do not own their stack
+    if (0 == thread->stack.size) {
+        free(thread->fpu);
+        free(thread);
+        return;
+    }
+    
+    // Space left in the pool?
+    spinlock_acquire(&_thread_pool_lock);
+    
+    bool pooled = (_thread_pool_count < THREAD_POOL_SIZE);
+    
+    if (pooled) {
+        thread->next = _thread_pool;
+        _thread_pool = thread;
+        ++_thread_pool_count;
+    }
+    
+    spinlock_release(&_thread_pool_lock);
+    
+    if (!pooled) {
+        free((void *) (thread->stack.addr - thread->stack.size));
+        free(thread->fpu);
+        free(thread);
+    }
+}
+
+/**
+ * Creates a thread structure for the calling context, which keeps running on
+ * its current stack, and makes it the current CPU's thread.
+ *
+ * @return The thread.
+ */
+static thread_t *_thread_boot(void)
+{
+    thread_t *thread = (thread_t *) malloc(sizeof(thread_t));
+    memset(thread, 0, sizeof(thread_t));
+    
+    thread->id = __sync_fetch_and_add(&_thread_next_id, 1);
+    thread->state = THREAD_STATE_RUNNING;
+    thread->on_cpu = true;
+    thread->fpu_cpu = FPU_CPU_NONE;
+    
+    percpu_write(thread_percpu_current, thread);
+    return thread;
+}
+
+/**
+ * Prepares the stack of a new thread, so the first switch to it returns into
+ * <tt>thread_context_start</tt> with the entry point in <tt>r12</tt> and its
+ * argument in <tt>r13</tt>.
+ *
+ * @param thread The thread.
+ * @param entry The entry point.
+ * @param arg The argument for the entry point.
+ */
+static void _thread_prepare(thread_t *thread, thread_entry_t entry, void *arg)
+{
+    uint64_t *sp = (uint64_t *) thread->stack.addr;
+    
+    *--sp = (uint64_t) (uintptr_t) &thread_context_start;
+    *--sp = 0;                          // rbp
+    *--sp = 0;                          // rbx
+    *--sp = (uint64_t) (uintptr_t) entry; // r12
+    *--sp = (uint64_t) (uintptr_t) arg; // r13
+    *--sp = 0;                          // r14
+    *--sp = 0;                          // r15
+    
+    thread->sp = (uintptr_t) sp;
+}
+
+//----------------------------------------------------------------------------//
+// Thread - Internal - Queues
+//----------------------------------------------------------------------------//
+
+/**
+ * Makes a thread ready by appending it to the current CPU's run queue, or the
+ * overflow queue if the run queue is full. Interrupts must be disabled.
+ *
+ * @param thread The thread.
+ */
+static void _thread_wake(thread_t *thread)
+{
+    thread->state = THREAD_STATE_READY;
+    
+    // Run queue full?
+    if (!thread_runq_push(&_thread_cpus[cpu_current_index()].runq, thread)) {
+        thread->next = 0;
+        spinlock_acquire(&_thread_overflow_lock);
+        
+        if (0 == _thread_overflow_head)
+            _thread_overflow_head = thread;
+        else
+            _thread_overflow_tail->next = thread;
+            
+        _thread_overflow_tail = thread;
+        spinlock_release(&_thread_overflow_lock);
+    }
+    
+    // Let a sleeping CPU steal it
+    cpu_idle_kick();
+}
+
+/**
+ * Takes the first thread from the overflow queue.
+ *
+ * @return The thread or a null-pointer, if the queue is empty.
+ */
+static thread_t *_thread_overflow_take(void)
+{
+    // Quick check without the lock
+    if (0 == _thread_overflow_head)
+        return 0;
+        
+    spinlock_acquire(&_thread_overflow_lock);
+    
+    thread_t *thread = _thread_overflow_head;
+    
+    if (0 != thread)
+        _thread_overflow_head = thread->next;
+        
+    spinlock_release(&_thread_overflow_lock);
+    return thread;
+}
+
+/**
+ * Finds the next thread to run on the current CPU: from its own run queue,
+ * the overflow queue, or stolen from other CPUs, closest first. Interrupts
+ * must be disabled.
+ *
+ * @param current The current thread.
+ * @return The thread or a null-pointer, if none is ready.
+ */
+static thread_t *_thread_pick(thread_t *current)
+{
+    thread_cpu_t *cpu = &_thread_cpus[cpu_current_index()];
+    thread_t *next = 0;
+    thread_t *busy = 0;
+    size_t source = 0;
+    
+    // Own run queue, the overflow queue, then steal
+    while (0 == next && source < cpu->victim_count + 2) {
+        if (0 == source)
+            next = thread_runq_take(&cpu->runq);
+        else if (1 == source)
+            next = _thread_overflow_take();
+        else
+            next = thread_runq_take(&_thread_cpus[cpu->victims[source - 2]].runq);
+            
+        // Source exhausted?
+        if (0 == next) {
+            ++source;
+            continue;
+        }
+        
+        // Context not yet saved by its last CPU? Skip it instead of waiting,
+        // as that CPU might be waiting for a thread of this one
+        if (next != current && next->on_cpu) {
+            next->next = busy;
+            busy = next;
+            next = 0;
+        }
+    }
+    
+    // Requeue skipped threads
+    while (0 != busy) {
+        thread_t *thread = busy;
+        busy = busy->next;
+        _thread_wake(thread);
+    }
+    
+    return next;
+}
+
+//----------------------------------------------------------------------------//
+// Thread - Internal - Switching
+//----------------------------------------------------------------------------//
+
+/**
+ * Timer callback ending the current time slice.
+ *
+ * @param arg Unused.
+ */
+static void _thread_slice_end(void *arg)
+{
+    percpu_write(thread_percpu_resched, true);
+}
+
+/**
+ * Arms the current CPU's time slice timer to end slices periodically.
+ *
+ * @param slice The current CPU's time slice timer.
+ */
+static void _thread_slice_start(cpu_timer_t *slice)
+{
+    cpu_timer_start(slice, cpu_timer_ticks() + THREAD_TIMESLICE, THREAD_TIMESLICE);
+}
+
+/**
+ * Completes a switch in the thread switched to: hands the previous thread's
+ * context over to other CPUs and releases or wakes the joiner of the previous
+ * thread, if it has exited.
+ *
+ * @param prev The thread that was switched away from.
+ */
+static void _thread_switch_finish(thread_t *prev)
+{
+    spinlock_acquire(&prev->lock);
+    
+    bool dead = (THREAD_STATE_DEAD == prev->state);
+    thread_t *joiner = dead ? prev->joiner : 0;
+    bool release = dead && 0 == joiner && (prev->flags & THREAD_FLAG_DETACHED);
+    
+    spinlock_release(&prev->lock);
+    
+    // Context is saved; last access unless released below
+    __sync_synchronize();
+    prev->on_cpu = false;
+    
+    if (0 != joiner)
+        _thread_wake(joiner);
+        
+    if (release)
+        _thread_free(prev);
+}
+
+/**
+ * Switches from the current thread to the given one. Interrupts must be
+ * disabled.
+ *
+ * @param prev The current thread.
+ * @param next The thread to switch to.
+ */
+static void _thread_switch(thread_t *prev, thread_t *next)
+{
+    // Save extended state, if used, and trap its next use
+    cpu_fpu_switch(prev);
+    
+    // Time slices only while not idle, so idle CPUs take no ticks
+    cpu_timer_t *slice = &_thread_cpus[cpu_current_index()].slice;
+    
+    if (next->flags & THREAD_FLAG_IDLE)
+        cpu_timer_cancel(slice);
+    else if (!slice->pending)
+        _thread_slice_start(slice);
+        
+    next->state = THREAD_STATE_RUNNING;
+    next->on_cpu = true;
+    percpu_write(thread_percpu_current, next);
+    percpu_write(thread_percpu_resched, false);
+    
+    prev = thread_context_switch(prev, next);
+    _thread_switch_finish(prev);
+}
+
+/**
+ * Switches to the next ready thread or the CPU's idle thread, if none is
+ * ready, after the current thread has been blocked or has exited. Interrupts
+ * must be disabled.
+ */
+static void _thread_schedule(void)
+{
+    thread_t *prev = percpu_read(thread_percpu_current);
+    thread_t *next = _thread_pick(prev);
+    
+    if (0 == next)
+        next = percpu_read(thread_percpu_idle);
+        
+    // Woken again before switching away?
+    if (next == prev) {
+        prev->state = THREAD_STATE_RUNNING;
+        return;
+    }
+    
+    _thread_switch(prev, next);
+}
+
+/**
+ * Checks whether the current CPU could run or steal a thread.
+ *
+ * @return Whether a thread is ready.
+ */
+static bool _thread_pending(void)
+{
+    thread_cpu_t *cpu = &_thread_cpus[cpu_current_index()];
+    
+    if (!thread_runq_empty(&cpu->runq) || 0 != _thread_overflow_head)
+        return true;
+        
+    size_t i;
+    
+    for (i = 0; i < cpu->victim_count; ++i)
+        if (!thread_runq_empty(&_thread_cpus[cpu->victims[i]].runq))
+            return true;
+            
+    return false;
+}
+
+/**
+ * Idle loop; runs whenever no other thread is ready on the CPU and sleeps
+ * until one might be.
+ *
+ * @param arg Unused.
+ */
+static void _thread_idle_loop(void *arg)
+{
+    while (1) {
+        thread_yield();
+        cpu_idle(&_thread_pending);
+    }
+}
+
+
+//----------------------------------------------------------------------------//
+// Thread - Initialization
+//----------------------------------------------------------------------------//
+
+void thread_init(void)
+{
+    // Boot context
+    _thread_boot();
+    
+    // Idle thread, only run when nothing else is ready
+    thread_t *idle = _thread_alloc();
+    idle->flags |= THREAD_FLAG_IDLE;
+    _thread_prepare(idle, &_thread_idle_loop, 0);
+    
+    percpu_write(thread_percpu_idle, idle);
+    
+    // Steal from SMT siblings first, then from the same package, starting
+    // with the next CPU to spread thieves over victims
+    size_t i, offset;
+    uint8_t distance;
+    
+    for (i = 0; i < cpu_count(); ++i) {
+        thread_cpu_t *thief = &_thread_cpus[i];
+        size_t count = 0;
+        
+        for (distance = CPU_TOPOLOGY_SIBLING; distance <= CPU_TOPOLOGY_REMOTE; ++distance)
+            for (offset = 1; offset < cpu_count(); ++offset) {
+                size_t victim = (i + offset) % cpu_count();
+                
+                if (distance == cpu_topology_distance(
+                        cpu_get_index(i), cpu_get_index(victim)))
+                    thief->victims[count++] = (uint16_t) victim;
+            }
+            
+        __sync_synchronize();
+        thief->victim_count = count;
+    }
+    
+    // Time slice timers, armed while threads other than the idle ones run
+    for (i = 0; i < cpu_count(); ++i) {
+        cpu_timer_setup(&_thread_cpus[i].slice, &_thread_slice_end, 0);
+        cpu_timer_set_slack(&_thread_cpus[i].slice, THREAD_TIMESLICE_SLACK);
+    }
+    
+    _thread_slice_start(&_thread_cpus[cpu_current_index()].slice);
+}
+
+void thread_idle(void)
+{
+    thread_t *idle = _thread_boot();
+    idle->flags |= THREAD_FLAG_IDLE;
+    
+    percpu_write(thread_percpu_idle, idle);
+    _thread_idle_loop(0);
+}
+
+void thread_start(thread_t *prev, thread_entry_t entry, void *arg)
+{
+    // Complete the switch to this thread
+    _thread_switch_finish(prev);
+    cpu_set_interruptable(true);
+    
+    // Run and exit
+    entry(arg);
+    thread_exit(0);
+}
+
+void thread_preempt(void)
+{
+    // Time slice not over yet, or threads not set up?
+    if (!percpu_read(thread_percpu_resched))
+        return;
+        
+    thread_t *current = percpu_read(thread_percpu_current);
+    
+    // Idle threads look for work themselves once woken
+    if (0 == current || (current->flags & THREAD_FLAG_IDLE))
+        return;
+        
+    // Deferred work of this CPU is not to be continued elsewhere
+    if (cpu_defer_running())
+        return;
+        
+    percpu_write(thread_percpu_resched, false);
+    thread_yield();
+}
+
+//----------------------------------------------------------------------------//
+// Thread
+//----------------------------------------------------------------------------//
+
+thread_t *thread_create(thread_entry_t entry, void *arg)
+{
+    thread_t *thread = _thread_alloc();
+    _thread_prepare(thread, entry, arg);
+    
+    // Queue to run on the current CPU, unless stolen
+    bool interruptable = cpu_is_interruptable();
+    cpu_set_interruptable(false);
+    _thread_wake(thread);
+    
+    if (interruptable)
+        cpu_set_interruptable(true);
+        
+    return thread;
+}
+
+void thread_exit(void *result)
+{
+    cpu_set_interruptable(false);
+    
+    thread_t *current = percpu_read(thread_percpu_current);
+    
+    spinlock_acquire(&current->lock);
+    current->result = result;
+    current->state = THREAD_STATE_DEAD;
+    spinlock_release(&current->lock);
+    
+    // Released or joined once switched away
+    _thread_schedule();
+    
+    // Never resumed
+    while (1);
+}
+
+void *thread_join(thread_t *thread)
+{
+    bool interruptable = cpu_is_interruptable();
+    cpu_set_interruptable(false);
+    
+    thread_t *current = percpu_read(thread_percpu_current);
+    
+    // Wait to be woken by the exiting thread
+    spinlock_acquire(&thread->lock);
+    
+    if (THREAD_STATE_DEAD != thread->state) {
+        current->state = THREAD_STATE_BLOCKED;
+        thread->joiner = current;
+        
+        spinlock_release(&thread->lock);
+        _thread_schedule();
+    } else
+        spinlock_release(&thread->lock);
+        
+    // Wait until the exit switch has completed
+    while (thread->on_cpu)
+        asm volatile ("pause");
+        
+    void *result = thread->result;
+    
+    if (interruptable)
+        cpu_set_interruptable(true);
+        
+    _thread_free(thread);
+    return result;
+}
+
+void thread_detach(thread_t *thread)
+{
+    bool interruptable = cpu_is_interruptable();
+    cpu_set_interruptable(false);
+    
+    spinlock_acquire(&thread->lock);
+    bool dead = (THREAD_STATE_DEAD == thread->state);
+    
+    if (!dead)
+        __sync_fetch_and_or(&thread->flags, THREAD_FLAG_DETACHED);
+        
+    spinlock_release(&thread->lock);
+    
+    // Exited already; release once the exit switch has completed
+    if (dead) {
+        while (thread->on_cpu)
+            asm volatile ("pause");
+            
+        _thread_free(thread);
+    }
+    
+    if (interruptable)
+        cpu_set_interruptable(true);
+}
+
+void thread_yield(void)
+{
+    bool interruptable = cpu_is_interruptable();
+    cpu_set_interruptable(false);
+    
+    thread_t *current = percpu_read(thread_percpu_current);
+    thread_t *next = (0 != current) ? _thread_pick(current) : 0;
+    
+    // Switch, requeueing the current thread unless idle
+    if (0 != next) {
+        if (0 == (current->flags & THREAD_FLAG_IDLE))
+            _thread_wake(current);
+        else
+            current->state = THREAD_STATE_READY;
+            
+        _thread_switch(current, next);
+    }
+    
+    if (interruptable)
+        cpu_set_interruptable(true);
+}
+
+thread_t *thread_current(void)
+{
+    return percpu_read(thread_percpu_current);
+}
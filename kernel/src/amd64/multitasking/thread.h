@@ -0,0 +1,89 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+#pragma once
+#include <api/types.h>
+#include <api/multitasking/thread.h>
+
+//----------------------------------------------------------------------------//
+// Thread - Constants
+//----------------------------------------------------------------------------//
+
+/**
+ * Size of a thread's kernel stack.
+ */
+#define THREAD_STACK_SIZE           0x4000
+
+/**
+ * Maximum number of released threads kept with their stacks for reuse.
+ */
+#define THREAD_POOL_SIZE            64
+
+/**
+ * Time slice after which a running thread is preempted, if other threads are
+ * ready, and how much later the preemption may happen (in timer ticks).
+ */
+#define THREAD_TIMESLICE            100
+#define THREAD_TIMESLICE_SLACK      10
+
+//----------------------------------------------------------------------------//
+// Thread - Preemption
+//----------------------------------------------------------------------------//
+
+/**
+ * Switches to the next ready thread if the current thread's time slice is
+ * over.
+ *
+ * Called on IRQ exit with interrupts disabled; the preempted thread resumes
+ * on the IRQ's exit path.
+ */
+void thread_preempt(void);
+
+//----------------------------------------------------------------------------//
+// Thread - Context Switch
+//----------------------------------------------------------------------------//
+
+/**
+ * Saves the callee-saved registers of the current context on its stack,
+ * stores the stack pointer in <tt>prev</tt> and resumes <tt>next</tt>.
+ *
+ * A thread that has not run yet starts in <tt>thread_context_start</tt>,
+ * which passes <tt>r12</tt> and <tt>r13</tt> to <tt>thread_start</tt>.
+ *
+ * @param prev The thread to save the current context to.
+ * @param next The thread to resume.
+ * @return The thread that was switched away from to resume this one.
+ */
+thread_t *thread_context_switch(thread_t *prev, thread_t *next);
+
+/**
+ * Start trampoline of new threads (not to be called).
+ */
+void thread_context_start(void);
+
+/**
+ * Finishes the switch from <tt>prev</tt> and runs the given entry point in
+ * the new thread.
+ *
+ * Called by <tt>thread_context_start</tt>; not to be called directly.
+ *
+ * @param prev The thread that was switched away from.
+ * @param entry The thread's entry point.
+ * @param arg The argument to pass to the entry point.
+ */
+void thread_start(thread_t *prev, thread_entry_t entry, void *arg);
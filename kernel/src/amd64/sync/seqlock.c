@@ -0,0 +1,60 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+ 
+#include <api/types.h>
+#include <api/sync/seqlock.h>
+
+//----------------------------------------------------------------------------//
+// Seqlock
+//----------------------------------------------------------------------------//
+
+/*
+ * Loads and stores are not reordered with each other on AMD64, so compiler
+ * barriers suffice.
+ */
+
+uint32_t seqlock_read_begin(seqlock_t *lock)
+{
+    uint32_t sequence;
+    
+    // Odd sequence: write in progress
+    while ((sequence = lock->sequence) & 1)
+        asm volatile ("pause");
+        
+    asm volatile ("" ::: "memory");
+    return sequence;
+}
+
+bool seqlock_read_retry(seqlock_t *lock, uint32_t sequence)
+{
+    asm volatile ("" ::: "memory");
+    return lock->sequence != sequence;
+}
+
+void seqlock_write_begin(seqlock_t *lock)
+{
+    ++lock->sequence;
+    asm volatile ("" ::: "memory");
+}
+
+void seqlock_write_end(seqlock_t *lock)
+{
+    asm volatile ("" ::: "memory");
+    ++lock->sequence;
+}
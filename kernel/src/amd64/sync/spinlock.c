@@ -36,7 +36,7 @@ void spinlock_acquire(spinlock_t *lock)
     bool interruptsActive = cpu_is_interruptable();
     
     // Stop interrupts
-    if (!interruptsActive)
+    if (interruptsActive)
         cpu_set_interruptable(false);
         
     // Try to acquire lock
@@ -47,13 +47,40 @@ void spinlock_acquire(spinlock_t *lock)
     if (interruptsActive) lock->flags |= SPINLOCK_FLAG_IRQ;
 }
 
+bool spinlock_try_acquire(spinlock_t *lock)
+{
+    // Check if interrupts are active
+    bool interruptsActive = cpu_is_interruptable();
+    
+    // Stop interrupts
+    if (interruptsActive)
+        cpu_set_interruptable(false);
+        
+    // Try to acquire lock once
+    if (!__sync_bool_compare_and_swap(&lock->lock, false, true)) {
+        if (interruptsActive)
+            cpu_set_interruptable(true);
+            
+        return false;
+    }
+    
+    // Store interrupt state
+    lock->flags = 0;
+    if (interruptsActive) lock->flags |= SPINLOCK_FLAG_IRQ;
+    
+    return true;
+}
+
 void spinlock_release(spinlock_t *lock)
 {
+    // Another CPU may take the lock and overwrite the flags once released
+    uint8_t flags = lock->flags;
+    
     // Release lock
     if (!__sync_bool_compare_and_swap(&lock->lock, true, false))
         return;
         
     // Restore interrupt state
-    if (lock->flags & SPINLOCK_FLAG_IRQ)
+    if (flags & SPINLOCK_FLAG_IRQ)
         cpu_set_interruptable(true);
 }
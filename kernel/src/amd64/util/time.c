@@ -17,9 +17,14 @@
  */
  
 #include <api/types.h>
+#include <api/compiler.h>
 #include <api/cpu.h>
-#include <api/cpu/timer.h>
+#include <api/cpu/int.h>
+#include <api/sync/seqlock.h>
 #include <api/util/time.h>
+#include <amd64/cpu.h>
+#include <amd64/cpu/features.h>
+#include <amd64/cpu/hpet.h>
 #include <amd64/util/time.h>
 #include <amd64/io/io.h>
 #include <amd64/io/cmos.h>
@@ -38,31 +43,371 @@
  */
 #define TIME_CONVERT_BCD(bcd)   ((bcd >> 1) + (bcd >> 3) + (bcd & 0xF))
 
+//----------------------------------------------------------------------------//
+// Time - Constants
+//----------------------------------------------------------------------------//
+
+#define TIME_NS_PER_SECOND      1000000000ULL
+
+/**
+ * Number of round trips to measure a CPU's TSC offset with.
+ */
+#define TIME_SYNC_ROUNDS        16
+
+/**
+ * Sync round number that ends a TSC offset measurement.
+ */
+#define TIME_SYNC_DONE          0xFFFFFFFF
+
+/**
+ * Sync target while no AP is measured.
+ */
+#define TIME_SYNC_NONE          0xFFFFFFFF
+
+/**
+ * The POST diagnostic port, written to for delays before a clock is running.
+ */
+#define TIME_POST_PORT          0x80
+
+//----------------------------------------------------------------------------//
+// Time - Structures
+//----------------------------------------------------------------------------//
+
+/**
+ * A CPU's view of the TSC clocksource.
+ *
+ * <tt>ns = ns_base + ((tsc - tsc_base) * mult) >> 32</tt>
+ */
+typedef struct time_clock_t
+{
+    /**
+     * Protects the other fields against concurrent updates.
+     */
+    seqlock_t lock;
+    
+    /**
+     * The CPU's TSC value at <tt>ns_base</tt>.
+     */
+    uint64_t tsc_base;
+    
+    /**
+     * Monotonic time in nanoseconds at <tt>tsc_base</tt>.
+     */
+    uint64_t ns_base;
+    
+    /**
+     * Nanoseconds per TSC cycle (fixed point, 32 fraction bits).
+     */
+    uint64_t mult;
+    
+    /**
+     * TSC cycles per nanosecond (fixed point, 32 fraction bits).
+     */
+    uint64_t inv_mult;
+    
+} ALIGNED(CACHE_LINE_SIZE) time_clock_t;
+
 //----------------------------------------------------------------------------//
 // Time - Variables
 //----------------------------------------------------------------------------//
 
 /**
- * The current UNIX time.
+ * Clocksource per CPU, indexed by the CPU's logical number, and for unknown CPUs.
+ */
+static time_clock_t _time_clocks[MAX_CPUS];
+static time_clock_t _time_clock_fallback;
+
+/**
+ * Whether the clocksource has been started.
  */
-static time_t _time_current = 0;
+static bool _time_clock_ready = false;
+
+/**
+ * Whether the HPET is the clocksource, as the TSC is not invariant, and the
+ * HPET's time at which the monotonic time started.
+ */
+static bool _time_hpet = false;
+static uint64_t _time_hpet_base = 0;
+
+/**
+ * Offset of the UNIX time to the monotonic time (in nanoseconds).
+ */
+static volatile uint64_t _time_realtime_offset = 0;
+
+/**
+ * State of the TSC offset measurement between the BSP and an AP.
+ */
+static volatile cpu_id_t _time_sync_target = TIME_SYNC_NONE;
+static volatile uint32_t _time_sync_round = 0;
+static volatile uint32_t _time_sync_ack = 0;
+static volatile uint64_t _time_sync_tsc = 0;
 
 //----------------------------------------------------------------------------//
 // Time - Internal
 //----------------------------------------------------------------------------//
 
 /**
- * Timer handler that is called every second the increase the system time by one
- * (only on BSP).
+ * Returns the clocksource of the given CPU.
+ *
+ * @param cpu The CPU's id.
+ * @return The CPU's clocksource.
+ */
+static time_clock_t *_time_clock(cpu_id_t cpu)
+{
+    cpu_t *info = cpu_get(cpu);
+    return (0 != info) ? &_time_clocks[info->index] : &_time_clock_fallback;
+}
+
+/**
+ * Sets a clocksource's parameters.
  *
- * @param ticks Current number of ticks.
- * @param ctx Interrupt context.
+ * @param clock The clocksource.
+ * @param tsc_base The TSC value at <tt>ns_base</tt>.
+ * @param ns_base The monotonic time at <tt>tsc_base</tt>.
+ * @param mult Nanoseconds per TSC cycle (32 fraction bits).
+ * @param inv_mult TSC cycles per nanosecond (32 fraction bits).
  */
-static void _time_update(uint64_t ticks, void *ctx)
+static void _time_clock_set(
+    time_clock_t *clock, uint64_t tsc_base, uint64_t ns_base, uint64_t mult,
+    uint64_t inv_mult)
+{
+    seqlock_write_begin(&clock->lock);
+    clock->tsc_base = tsc_base;
+    clock->ns_base = ns_base;
+    clock->mult = mult;
+    clock->inv_mult = inv_mult;
+    seqlock_write_end(&clock->lock);
+}
+
+//----------------------------------------------------------------------------//
+// Time - Clocksource
+//----------------------------------------------------------------------------//
+
+void time_clock_init(void)
+{
+    // Nanoseconds per cycle
+    uint64_t hz = cpu_tsc_frequency();
+    uint64_t mult = (TIME_NS_PER_SECOND << 32) / hz;
+    uint64_t tsc = cpu_tsc_read();
+    
+    // Cycles per nanosecond (split, so the shift can not overflow)
+    uint64_t inv_mult =
+        ((hz / TIME_NS_PER_SECOND) << 32) +
+        ((hz % TIME_NS_PER_SECOND) << 32) / TIME_NS_PER_SECOND;
+    
+    // Same parameters on all CPUs until their offsets are measured
+    size_t i;
+    
+    for (i = 0; i < MAX_CPUS; ++i)
+        _time_clock_set(&_time_clocks[i], tsc, 0, mult, inv_mult);
+        
+    _time_clock_set(&_time_clock_fallback, tsc, 0, mult, inv_mult);
+    _time_clock_ready = true;
+    
+    console_debug("[TIME] TSC frequency: ");
+    console_debug_dec(hz);
+    console_debug(" Hz\n");
+    
+    // Fall back to the HPET if the TSC may drift
+    if (!cpu_feature_present(CPU_FEATURE_INVARIANT_TSC)) {
+        if (cpu_hpet_wide()) {
+            _time_hpet_base = cpu_hpet_ns();
+            _time_hpet = true;
+            console_debug("[TIME] TSC is not invariant, using HPET.\n");
+        } else
+            console_debug("[TIME] TSC is not invariant, clock may drift.\n");
+    }
+}
+
+void time_sync_bsp(cpu_id_t ap)
+{
+    uint64_t best_rtt = (uint64_t) -1;
+    int64_t offset = 0;
+    uint32_t round;
+    
+    bool interruptable = cpu_is_interruptable();
+    cpu_set_interruptable(false);
+    
+    // Select AP (others keep waiting for their turn)
+    _time_sync_target = ap;
+    
+    // Measure round trips, keeping the sample with the shortest one
+    for (round = 1; round <= TIME_SYNC_ROUNDS; ++round) {
+        uint64_t begin = cpu_tsc_read_ordered();
+        _time_sync_round = round;
+        
+        while (_time_sync_ack != round)
+            asm volatile ("pause");
+            
+        uint64_t end = cpu_tsc_read_ordered();
+        
+        if (end - begin < best_rtt) {
+            best_rtt = end - begin;
+            offset = (int64_t) (_time_sync_tsc - (begin + best_rtt / 2));
+        }
+    }
+    
+    // Release AP and reset for the next one
+    _time_sync_round = TIME_SYNC_DONE;
+    
+    while (_time_sync_ack != TIME_SYNC_DONE)
+        asm volatile ("pause");
+        
+    _time_sync_round = 0;
+    _time_sync_ack = 0;
+    _time_sync_target = TIME_SYNC_NONE;
+    
+    if (interruptable)
+        cpu_set_interruptable(true);
+        
+    // Offsets within the measurement error are ignored
+    if (offset < (int64_t) best_rtt && offset > -((int64_t) best_rtt))
+        return;
+        
+    // Shift the AP's TSC base by its offset
+    time_clock_t *bsp = &_time_clocks[cpu_current_index()];
+    
+    _time_clock_set(
+        _time_clock(ap),
+        bsp->tsc_base + offset,
+        bsp->ns_base,
+        bsp->mult,
+        bsp->inv_mult);
+        
+    console_debug("[TIME] TSC offset of CPU ");
+    console_debug_hex(ap);
+    console_debug(": ");
+    console_debug_dec(offset);
+    console_debug(" cycles\n");
+}
+
+void time_sync_ap(void)
+{
+    uint32_t last = 0;
+    cpu_id_t self = cpu_current_id();
+    
+    // Wait until selected by the BSP
+    while (_time_sync_target != self)
+        asm volatile ("pause");
+        
+    while (1) {
+        uint32_t round;
+        
+        // Wait for next round
+        while ((round = _time_sync_round) == last)
+            asm volatile ("pause");
+            
+        if (TIME_SYNC_DONE == round) {
+            _time_sync_ack = TIME_SYNC_DONE;
+            return;
+        }
+        
+        // Answer with own TSC
+        _time_sync_tsc = cpu_tsc_read_ordered();
+        _time_sync_ack = round;
+        last = round;
+    }
+}
+
+uint64_t time_monotonic_ns(void)
+{
+    // Global HPET clocksource?
+    if (_time_hpet)
+        return cpu_hpet_ns() - _time_hpet_base;
+        
+    time_clock_t *clock;
+    uint64_t ns;
+    uint32_t sequence;
+    size_t index, current;
+    
+    // Retry if migrated, so the TSC is read with its own CPU's clocksource
+    do {
+        index = cpu_current_index();
+        clock = &_time_clocks[index];
+        sequence = seqlock_read_begin(&clock->lock);
+        
+        uint64_t tsc = cpu_tsc_read_index(&current);
+        uint64_t delta = (tsc > clock->tsc_base) ? tsc - clock->tsc_base : 0;
+        
+        ns = clock->ns_base + (uint64_t) (((unsigned __int128) delta * clock->mult) >> 32);
+    } while (current != index || seqlock_read_retry(&clock->lock, sequence));
+    
+    return ns;
+}
+
+uint64_t time_ns_to_tsc(uint64_t ns)
+{
+    time_clock_t *clock;
+    uint64_t tsc;
+    uint32_t sequence;
+    size_t index;
+    
+    // Global HPET clocksource: convert the distance to the current time
+    if (_time_hpet) {
+        uint64_t now = time_monotonic_ns();
+        uint64_t delta = (ns > now) ? ns - now : 0;
+        
+        tsc = cpu_tsc_read_index(&index);
+        clock = &_time_clocks[index];
+        
+        return tsc + (uint64_t) (((unsigned __int128) delta * clock->inv_mult) >> 32);
+    }
+    
+    // Retry if migrated, as the result is only valid for the CPU's own TSC
+    do {
+        index = cpu_current_index();
+        clock = &_time_clocks[index];
+        sequence = seqlock_read_begin(&clock->lock);
+        
+        uint64_t delta = (ns > clock->ns_base) ? ns - clock->ns_base : 0;
+        
+        tsc = clock->tsc_base + (uint64_t) (((unsigned __int128) delta * clock->inv_mult) >> 32);
+    } while (index != cpu_current_index() || seqlock_read_retry(&clock->lock, sequence));
+    
+    return tsc;
+}
+
+uint64_t time_realtime_ns(void)
+{
+    return time_monotonic_ns() + _time_realtime_offset;
+}
+
+//----------------------------------------------------------------------------//
+// Time - Delays
+//----------------------------------------------------------------------------//
+
+void ndelay(uint64_t ns)
+{
+    // Clocksource running?
+    if (_time_clock_ready) {
+        uint64_t end = time_monotonic_ns() + ns;
+        
+        while (time_monotonic_ns() < end)
+            asm volatile ("pause");
+            
+        return;
+    }
+    
+    // HPET started?
+    if (cpu_hpet_present()) {
+        uint64_t begin = cpu_hpet_read();
+        
+        while (cpu_hpet_elapsed_ns(begin) < ns)
+            asm volatile ("pause");
+            
+        return;
+    }
+    
+    // Otherwise each write to the POST port takes about a microsecond
+    uint64_t us;
+    
+    for (us = 0; us < (ns + 999) / 1000; ++us)
+        io_outb(TIME_POST_PORT, 0);
+}
+
+void udelay(uint64_t us)
 {
-    // Is BSP?
-    if (cpu_get(cpu_current_id())->flags & CPU_FLAG_BSP)
-        ++_time_current;
+    ndelay(us * 1000);
 }
 
 //----------------------------------------------------------------------------//
@@ -115,17 +460,13 @@ void time_init(void)
     // Add century to year
     year += (century - 1) * 100;
     
-    // Make time
-    _time_current = time_make(
+    // Make time and anchor it to the monotonic clock
+    time_t current = time_make(
         year, month, dom, hour, minute, second);
-        
-    // Add timer handler
-    cpu_timer_register(
-        &_time_update,
-        1000000 / cpu_timer_interval());
+    _time_realtime_offset = current * TIME_NS_PER_SECOND - time_monotonic_ns();
 }
 
 time_t time_current(void)
 {
-    return _time_current;
+    return time_realtime_ns() / TIME_NS_PER_SECOND;
 }
@@ -18,12 +18,51 @@
 
 #pragma once 
 #include <api/types.h>
+#include <api/cpu.h>
 
 //----------------------------------------------------------------------------//
 // Time
 //----------------------------------------------------------------------------//
 
 /**
- * Initializes the timer using the system's CMOS clock.
+ * Initializes the UNIX time using the system's CMOS clock.
  */
 void time_init(void);
+
+//----------------------------------------------------------------------------//
+// Time - Clocksource
+//----------------------------------------------------------------------------//
+
+/**
+ * Starts the TSC clocksource on all CPUs.
+ *
+ * Only to be called once on the BSP after the TSC has been calibrated.
+ */
+void time_clock_init(void);
+
+/**
+ * Converts a monotonic time to the current CPU's TSC value at that time.
+ *
+ * @param ns The monotonic time in nanoseconds.
+ * @return The TSC value.
+ */
+uint64_t time_ns_to_tsc(uint64_t ns);
+
+/**
+ * Measures the TSC offset of an AP against the BSP's and corrects the AP's
+ * clocksource accordingly.
+ *
+ * To be called on the BSP while the AP runs <tt>time_sync_ap</tt>; APs are
+ * measured one after another.
+ *
+ * @param ap The id of the AP.
+ */
+void time_sync_bsp(cpu_id_t ap);
+
+/**
+ * Answers the TSC offset measurement of the BSP.
+ *
+ * To be called on an AP during startup; waits for the BSP to select this AP,
+ * so several APs may wait at once, and returns when the BSP is done.
+ */
+void time_sync_ap(void);
@@ -26,3 +26,10 @@
 #define UNLIKELY(exp) __builtin_expect(!!(exp), 0)
 
 #define PACKED __attribute__((packed))
+#define MAY_ALIAS __attribute__((__may_alias__))
+#define ALIGNED(n) __attribute__((aligned(n)))
+
+/**
+ * Size of a cache line; data written by different CPUs is kept apart by it.
+ */
+#define CACHE_LINE_SIZE 64
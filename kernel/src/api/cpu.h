@@ -18,16 +18,35 @@
 
 #pragma once
 #include <api/types.h>
+#include <api/compiler.h>
 #include <api/sync/spinlock.h>
 
+//------------------------------------------------------------------------------
+// CPU - Configuration
+//------------------------------------------------------------------------------
+
+/**
+ * Maximum number of CPUs supported; further CPUs are ignored.
+ *
+ * Set at build time with <tt>MAX_CPUS=n</tt>.
+ */
+#ifndef MAX_CPUS
+    #define MAX_CPUS 64
+#endif
+
+// Logical numbers (plus one in the id map) are stored in 16 bits
+#if MAX_CPUS < 1 || MAX_CPUS > 0xFFFF
+    #error "MAX_CPUS must be between 1 and 65535"
+#endif
+
 //------------------------------------------------------------------------------
 // CPU - Types
 //------------------------------------------------------------------------------
 
 /**
- * The id of a CPU.
+ * The id of a CPU (its APIC id; 32 bits in x2APIC mode).
  */
-typedef uint8_t cpu_id_t;
+typedef uint32_t cpu_id_t;
 
 //------------------------------------------------------------------------------
 // CPU - Flags
@@ -75,17 +94,34 @@ typedef struct cpu_t
      */
     uint8_t flags;
     
+    /**
+     * The CPU's dense logical number (<tt>0</tt> to <tt>cpu_count() - 1</tt>).
+     */
+    uint32_t index;
+    
+    /**
+     * Ids of the CPU's core and package; CPUs with equal ids share the core
+     * (SMT siblings) or package.
+     */
+    uint32_t core;
+    uint32_t package;
+    
     /**
      * The CPU's lock.
      */
     spinlock_t lock;
     
     /**
-     * Pointer to the next CPU.
+     * Bitmap of the platform specific features the CPU supports.
      */
-    struct cpu_t *next;
+    uint64_t features;
     
-} cpu_t;
+    /**
+     * Address of the CPU's per-CPU data area.
+     */
+    uintptr_t percpu;
+    
+} ALIGNED(CACHE_LINE_SIZE) cpu_t;
 
 //------------------------------------------------------------------------------
 // CPU - API
@@ -99,6 +135,17 @@ typedef struct cpu_t
  */
 cpu_t *cpu_get(cpu_id_t id);
 
+/**
+ * Returns a pointer to a CPU, given its logical number.
+ *
+ * CPUs are iterated with <tt>index</tt> from <tt>0</tt> to
+ * <tt>cpu_count() - 1</tt>.
+ *
+ * @param index The logical number of the CPU.
+ * @return Pointer to the CPU or a null-pointer.
+ */
+cpu_t *cpu_get_index(size_t index);
+
 /**
  * Returns the id of the CPU calling this function.
  *
@@ -107,11 +154,18 @@ cpu_t *cpu_get(cpu_id_t id);
 cpu_id_t cpu_current_id(void);
 
 /**
- * Returns a pointer to the first CPU in the linked list of CPUs.
+ * Returns a pointer to the CPU calling this function.
+ *
+ * @return Pointer to the current CPU.
+ */
+cpu_t *cpu_current(void);
+
+/**
+ * Returns the logical number of the CPU calling this function.
  *
- * @return Pointer to the first CPU.
+ * @return Current CPU's logical number.
  */
-cpu_t *cpu_get_first(void);
+size_t cpu_current_index(void);
 
 /**
  * Returns the number of CPUs installed into the system.
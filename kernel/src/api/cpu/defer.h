@@ -0,0 +1,46 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+
+#pragma once
+#include <api/types.h>
+
+//----------------------------------------------------------------------------//
+// Deferred Work
+//----------------------------------------------------------------------------//
+
+/**
+ * A deferred work handler (bottom half).
+ *
+ * @param arg The argument passed to <tt>cpu_defer</tt>.
+ */
+typedef void (*defer_handler_t)(void *);
+
+/**
+ * Defers the given handler to run on the current CPU with interrupts enabled,
+ * right after the current IRQ has been handled.
+ *
+ * May be called from IRQ handlers and with interrupts enabled. Work is run in
+ * the order it has been deferred.
+ *
+ * @param handler The handler to run.
+ * @param arg The argument to pass to the handler.
+ * @return Whether the work has been queued; <tt>false</tt>, if the current
+ *  CPU's queue is full or not yet initialized.
+ */
+bool cpu_defer(defer_handler_t handler, void *arg);
@@ -50,6 +50,44 @@ typedef void *(*interrupt_handler_t)(interrupt_vector_t, void *);
  */
 void cpu_int_register(interrupt_vector_t vector, interrupt_handler_t handler);
 
+/**
+ * A lightweight interrupt request handler.
+ *
+ * IRQ handlers are called through a fast path that only preserves the state a
+ * function call may clobber. They have no access to the interrupted context
+ * and can not switch to another one.
+ *
+ * Handlers must acknowledge the interrupt before returning: deferred work
+ * (see <tt>cpu_defer</tt>) runs on IRQ exit with interrupts enabled.
+ *
+ * @param The vector of the interrupt.
+ */
+typedef void (*irq_handler_t)(interrupt_vector_t);
+
+/**
+ * Registers an IRQ handler for the given interrupt vector, replacing a
+ * previously registered (IRQ or interrupt) handler.
+ *
+ * Must not be used for exception vectors.
+ *
+ * @param vector The interrupt vector to register the handler for.
+ * @param handler The IRQ handler to register.
+ */
+void cpu_int_register_irq(interrupt_vector_t vector, irq_handler_t handler);
+
+//----------------------------------------------------------------------------//
+// Interrupts - Statistics
+//----------------------------------------------------------------------------//
+
+/**
+ * Prints the number of interrupts and the handler durations per CPU and vector
+ * to the console.
+ *
+ * Statistics are only recorded if the kernel has been built with
+ * <tt>__INT_STATS__</tt>.
+ */
+void cpu_int_stats_dump(void);
+
 //----------------------------------------------------------------------------//
 // Interrupts - State
 //----------------------------------------------------------------------------//
@@ -0,0 +1,83 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+
+#pragma once
+#include <api/types.h>
+#include <api/cpu.h>
+#include <api/cpu/int.h>
+
+//----------------------------------------------------------------------------//
+// IRQ Routing - Constants
+//----------------------------------------------------------------------------//
+
+/**
+ * Deliver the IRQ to the first CPU of the destination set.
+ */
+#define IRQ_DELIVERY_FIXED          0x0
+
+/**
+ * Deliver the IRQ to the CPU of the destination set that currently runs at the
+ * lowest priority.
+ */
+#define IRQ_DELIVERY_LOWEST         0x1
+
+//----------------------------------------------------------------------------//
+// IRQ Routing
+//----------------------------------------------------------------------------//
+
+/**
+ * Returns the Global System Interrupt a legacy ISA IRQ is connected to.
+ *
+ * @param irq The ISA IRQ (0 - 15).
+ * @return The GSI, taking interrupt source overrides into account.
+ */
+uint32_t cpu_irq_gsi(uint8_t irq);
+
+/**
+ * Routes a Global System Interrupt to the given interrupt vector on the given
+ * set of CPUs and unmasks it.
+ *
+ * Lowest priority delivery is restricted to the first eight CPUs (flat logical
+ * destination mode); if none of the given CPUs is among them, the IRQ is
+ * delivered to the first CPU of the set.
+ *
+ * @param gsi The GSI to route.
+ * @param vector The vector to deliver the IRQ as.
+ * @param delivery The delivery mode (<tt>IRQ_DELIVERY_*</tt>).
+ * @param cpus The ids of the destination CPUs.
+ * @param count The number of destination CPUs (at least one).
+ * @return Whether the GSI could be routed.
+ */
+bool cpu_irq_route(
+    uint32_t gsi, interrupt_vector_t vector, uint8_t delivery,
+    const cpu_id_t *cpus, size_t count);
+
+/**
+ * Masks the given Global System Interrupt.
+ *
+ * @param gsi The GSI to mask.
+ */
+void cpu_irq_mask(uint32_t gsi);
+
+/**
+ * Unmasks the given Global System Interrupt.
+ *
+ * @param gsi The GSI to unmask.
+ */
+void cpu_irq_unmask(uint32_t gsi);
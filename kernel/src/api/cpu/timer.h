@@ -18,25 +18,163 @@
  
 #pragma once
 #include <api/types.h>
+#include <api/cpu.h>
 
 //----------------------------------------------------------------------------//
 // Timer
 //----------------------------------------------------------------------------//
 
 /**
- * Returns the timer's interval in micro seconds.
+ * Returns the length of a timer tick in micro seconds.
  *
- * @return Timer's interval in micro seconds.
+ * @return Length of a tick in micro seconds.
  */
 uint32_t cpu_timer_interval(void);
 
 /**
- * Returns the current timer's ticks since system startup or last overflow.
+ * Returns the number of timer ticks since system startup.
+ *
+ * Derived from the monotonic clock; no timer interrupts are required for the
+ * count to advance.
  * 
  * @return The current timer's ticks.
  */
 uint64_t cpu_timer_ticks(void);
 
+//----------------------------------------------------------------------------//
+// Timer - One-shot Timers
+//----------------------------------------------------------------------------//
+
+/**
+ * Type of timer callbacks.
+ *
+ * @param arg The argument given on setup.
+ */
+typedef void (*timer_callback_t)(void *);
+
+/**
+ * A timer that fires once at a given tick, or periodically.
+ *
+ * Allocated by the caller and set up with <tt>cpu_timer_setup</tt>; all other
+ * fields are managed by the timer subsystem.
+ */
+typedef struct cpu_timer_t
+{
+    /**
+     * Links in the timer wheel slot.
+     */
+    struct cpu_timer_t *next, *prev;
+    
+    /**
+     * The tick the timer expires at.
+     */
+    uint64_t expires;
+    
+    /**
+     * The number of ticks the timer may fire late, so it can share an
+     * interrupt with other timers.
+     */
+    uint64_t slack;
+    
+    /**
+     * The tick within <tt>[expires, expires + slack]</tt> the timer is placed
+     * at in the timer wheel.
+     */
+    uint64_t deadline;
+    
+    /**
+     * The period in ticks or <tt>0</tt> for one-shot timers.
+     */
+    uint64_t period;
+    
+    /**
+     * The callback and its argument.
+     */
+    timer_callback_t callback;
+    void *arg;
+    
+    /**
+     * The CPU the timer is armed on.
+     */
+    cpu_id_t cpu;
+    
+    /**
+     * Position in the timer wheel (level and slot).
+     */
+    uint8_t level, slot;
+    
+    /**
+     * Whether the timer is armed.
+     */
+    bool pending;
+    
+} cpu_timer_t;
+
+/**
+ * Prepares a timer for use.
+ *
+ * @param timer The timer.
+ * @param callback The callback to call when the timer fires.
+ * @param arg The argument to pass to the callback.
+ */
+void cpu_timer_setup(cpu_timer_t *timer, timer_callback_t callback, void *arg);
+
+/**
+ * Sets the slack of a timer, i.e. the number of ticks it may fire after its
+ * expiry.
+ *
+ * Timers whose windows overlap are coalesced into a single interrupt. Takes
+ * effect the next time the timer is armed.
+ *
+ * @param timer The timer.
+ * @param slack The slack in ticks (<tt>0</tt> by default).
+ */
+void cpu_timer_set_slack(cpu_timer_t *timer, uint64_t slack);
+
+/**
+ * Arms a timer on the current CPU, re-arming it if already pending.
+ *
+ * The callback runs on the CPU with interrupts enabled, after the timer
+ * interrupt has been handled.
+ *
+ * @param timer The timer.
+ * @param expires The tick to fire at (see <tt>cpu_timer_ticks</tt>).
+ * @param period The period in ticks or <tt>0</tt> for a one-shot timer.
+ */
+void cpu_timer_start(cpu_timer_t *timer, uint64_t expires, uint64_t period);
+
+/**
+ * Arms a timer on the given CPU, re-arming it if already pending.
+ *
+ * @param timer The timer.
+ * @param expires The tick to fire at (see <tt>cpu_timer_ticks</tt>).
+ * @param period The period in ticks or <tt>0</tt> for a one-shot timer.
+ * @param cpu The id of the CPU to fire on.
+ * @return Whether the timer could be armed on the CPU.
+ */
+bool cpu_timer_start_on(
+    cpu_timer_t *timer, uint64_t expires, uint64_t period, cpu_id_t cpu);
+
+/**
+ * Disarms a timer.
+ *
+ * @param timer The timer.
+ * @return Whether the timer was pending. If not, its callback might be
+ *  running right now.
+ */
+bool cpu_timer_cancel(cpu_timer_t *timer);
+
+/**
+ * Disarms a timer and waits for a running call of its callback to return,
+ * so the timer may be freed afterwards.
+ *
+ * Must not be called from the timer's own callback.
+ *
+ * @param timer The timer.
+ * @return Whether the timer was pending.
+ */
+bool cpu_timer_cancel_sync(cpu_timer_t *timer);
+
 //----------------------------------------------------------------------------//
 // Timer - Handling
 //----------------------------------------------------------------------------//
@@ -46,22 +184,91 @@ uint64_t cpu_timer_ticks(void);
  *
  * @param ticks The current timer's ticks.
  * @param ctx The interrupt context of the IRQ that caused the handler to be
- *  called.
+ *  called or a null-pointer, if the timer IRQ does not provide its context.
  */
 typedef void (*timer_handler_t)(uint64_t, void *);
 
 /**
- * Registers a handler to the timer, given its callback and granularity.
+ * Registers a handler to the timer of a single CPU, given its callback and
+ * granularity.
+ *
+ * @param handler The handler's callback.
+ * @param granularity The granularity of the handler, i.e. the number of ticks
+ *  that have to pass until the handler is called again.
+ * @param slack The number of ticks the handler may be called late.
+ * @param cpu The id of the CPU to call the handler on.
+ * @return Whether the handler could be registered.
+ */
+bool cpu_timer_register_on(
+    timer_handler_t handler, uint32_t granularity, uint32_t slack, cpu_id_t cpu);
+
+/**
+ * Registers a handler to the timers of all (initialized) CPUs, given its
+ * callback and granularity.
  *
  * @param handler The handler's callback.
  * @param granularity The granularity of the handler, i.e. the number of ticks
  *  that have to pass until the handler is called again.
+ * @param slack The number of ticks the handler may be called late.
+ */
+void cpu_timer_register(
+    timer_handler_t handler, uint32_t granularity, uint32_t slack);
+
+/**
+ * Unregisters a handler from the timer of a single CPU.
+ *
+ * Waits for a running call of the handler on that CPU to return; must not be
+ * called from the handler itself.
+ *
+ * @param handler The callback of the handler to unregister.
+ * @param cpu The id of the CPU.
  */
-void cpu_timer_register(timer_handler_t handler, uint32_t granularity);
+void cpu_timer_unregister_on(timer_handler_t handler, cpu_id_t cpu);
 
 /**
- * Unregisters a handler from the timer.
+ * Unregisters a handler from the timers of all CPUs.
  *
  * @param handler The callback of the handler to unregister.
  */
 void cpu_timer_unregister(timer_handler_t handler);
+
+//----------------------------------------------------------------------------//
+// Timer - Statistics
+//----------------------------------------------------------------------------//
+
+/**
+ * Timer wakeup statistics of a CPU.
+ */
+typedef struct cpu_timer_stats_t
+{
+    /**
+     * Number of timer interrupts that ran at least one timer.
+     */
+    uint64_t wakeups;
+    
+    /**
+     * Number of timers that have fired.
+     */
+    uint64_t expired;
+    
+    /**
+     * Number of timers that fired in the interrupt of another timer, i.e.
+     * the wakeups saved by coalescing.
+     */
+    uint64_t coalesced;
+    
+} cpu_timer_stats_t;
+
+/**
+ * Returns the timer wakeup statistics of a CPU.
+ *
+ * @param cpu The id of the CPU.
+ * @param stats The structure to write the statistics to.
+ * @return Whether the CPU has statistics.
+ */
+bool cpu_timer_stats(cpu_id_t cpu, cpu_timer_stats_t *stats);
+
+/**
+ * Prints the timer wakeup statistics of all CPUs to the console.
+ */
+void cpu_timer_stats_dump(void);
@@ -57,6 +57,23 @@ void console_put(char c);
  */
 void console_clear(void);
 
+//----------------------------------------------------------------------------//
+// Debug Printing
+//----------------------------------------------------------------------------//
+
+/**
+ * Verbose (boot) messages that are only printed by debug builds.
+ */
+#ifdef __DEBUG__
+    #define console_debug(str)      console_print(str)
+    #define console_debug_hex(num)  console_print_hex(num)
+    #define console_debug_dec(num)  console_print_dec(num)
+#else
+    #define console_debug(str)
+    #define console_debug_hex(num)
+    #define console_debug_dec(num)
+#endif
+
 //----------------------------------------------------------------------------//
 // Color
 //----------------------------------------------------------------------------//
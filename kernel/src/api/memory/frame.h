@@ -60,6 +60,15 @@ void frame_relocate(uintptr_t virt);
  */
 uintptr_t frame_alloc();
 
+/**
+ * Allocates a number of physically contiguous frames.
+ *
+ * @param count The number of frames to allocate.
+ * @param alignment The alignment of the first frame's address.
+ * @return Address of the first frame or <tt>(uintptr_t) -1</tt> on error.
+ */
+uintptr_t frame_alloc_contiguous(size_t count, uintptr_t alignment);
+
 /**
  * Frees a frame.
  *
@@ -18,6 +18,7 @@
  
 #pragma once
 #include <api/types.h>
+#include <api/sync/spinlock.h>
 
 //------------------------------------------------------------------------------
 // Heap - Generic
@@ -52,3 +53,48 @@ void *realloc(void *ptr, size_t size);
 //------------------------------------------------------------------------------
 
 uint64_t heap_sbrk(intptr_t increase);
+
+/**
+ * Maps a new region of memory that is independent of the contiguous heap.
+ *
+ * Used to serve large allocations, so they can be returned to the system when
+ * they are freed.
+ *
+ * @param length The length of the region to map. Will be page aligned.
+ * @return The address of the new region or <tt>(void *) -1</tt> on error.
+ */
+void *heap_mmap(size_t length);
+
+/**
+ * Unmaps (a part of) memory mapped using <tt>heap_mmap</tt> and frees the
+ * frames backing it.
+ *
+ * @param addr The address to begin unmapping at.
+ * @param length The number of bytes to unmap. Will be page aligned.
+ * @return <tt>0</tt> on success.
+ */
+int heap_munmap(void *addr, size_t length);
+
+/**
+ * Changes the length of a region mapped using <tt>heap_mmap</tt>.
+ *
+ * The region is never moved: it is grown by mapping additional pages directly
+ * behind it, which fails if another region is in the way.
+ *
+ * @param addr The address of the region.
+ * @param old_length The current length of the region.
+ * @param new_length The new length of the region. Will be page aligned.
+ * @param flags Whether the region may be moved (ignored).
+ * @return The address of the region or <tt>(void *) -1</tt> on error.
+ */
+void *heap_mremap(void *addr, size_t old_length, size_t new_length, int flags);
+
+/**
+ * Acquires a lock of the heap or the allocator.
+ *
+ * The holder may be unmapping memory and waiting for other CPUs to flush their
+ * TLBs, so pending flushes are handled while spinning.
+ *
+ * @param lock The lock to acquire.
+ */
+void heap_lock_acquire(spinlock_t *lock);
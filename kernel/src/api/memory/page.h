@@ -32,8 +32,11 @@ typedef uintptr_t page_t;
 #define PG_PRESENT      1 << 0          // Present
 #define PG_WRITABLE     1 << 1          // Writable
 #define PG_USER         1 << 2          // User-accessible
+#define PG_WRITE_THROUGH 1 << 3         // Write-through caching
+#define PG_CACHE_DISABLE 1 << 4         // Caching disabled
+#define PG_ACCESSED     1 << 5          // Accessed
 #define PG_DIRTY        1 << 6          // Dirty
-#define PG_ACCESSED     1 << 7          // Accessed
+#define PG_LARGE        1 << 7          // Large page (only in PDEs)
 #define PG_GLOBAL       1 << 8          // Global
 
 //----------------------------------------------------------------------------//
@@ -54,7 +57,8 @@ void page_map(uintptr_t virt, uintptr_t phys, uint16_t flags);
 /**
  * Unmaps the given page.
  *
- * Unsets the present flag.
+ * Unsets the present flag. If the address is mapped by a large page, the whole
+ * large page is unmapped.
  *
  * @param virt The virtual address mapped by the page.
  * @return Pointer to the page.
@@ -74,6 +78,31 @@ void page_unmap(uintptr_t virt);
  */
 uintptr_t page_get_physical(uintptr_t virt);
 
+//----------------------------------------------------------------------------//
+// Page - Frame Contents
+//----------------------------------------------------------------------------//
+
+/**
+ * Fills the page frame at the given physical address with zeroes.
+ *
+ * Uses non-temporal stores, so the zeroed frame does not displace other data
+ * from the cache.
+ *
+ * @param phys The (page aligned) physical address of the frame.
+ */
+void page_zero(uintptr_t phys);
+
+/**
+ * Copies the contents of one page frame to another.
+ *
+ * Uses non-temporal stores, so the destination frame does not displace other
+ * data from the cache.
+ *
+ * @param dest The (page aligned) physical address of the destination frame.
+ * @param src The (page aligned) physical address of the source frame.
+ */
+void page_copy(uintptr_t dest, uintptr_t src);
+
 //----------------------------------------------------------------------------//
 // Page - Address Space
 //----------------------------------------------------------------------------//
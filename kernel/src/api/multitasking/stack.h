@@ -18,8 +18,6 @@
 
 #pragma once
 #include <api/types.h>
-#include <api/multitasking/thread.h>
-#include <api/multitasking/process.h>
 
 //----------------------------------------------------------------------------//
 // Stack - Structures
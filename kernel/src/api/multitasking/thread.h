@@ -0,0 +1,186 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <api/types.h>
+#include <api/multitasking/stack.h>
+#include <api/sync/spinlock.h>
+
+//----------------------------------------------------------------------------//
+// Thread - Types
+//----------------------------------------------------------------------------//
+
+/**
+ * Type for thread ids.
+ */
+typedef uint64_t thread_id_t;
+
+/**
+ * Entry point of a thread.
+ *
+ * @param arg The argument passed to <tt>thread_create</tt>.
+ */
+typedef void (*thread_entry_t)(void *);
+
+//----------------------------------------------------------------------------//
+// Thread - States and Flags
+//----------------------------------------------------------------------------//
+
+#define THREAD_STATE_READY          0       // Queued to run
+#define THREAD_STATE_RUNNING        1       // Running on a CPU
+#define THREAD_STATE_BLOCKED        2       // Waiting to be woken
+#define THREAD_STATE_DEAD           3       // Exited, not yet joined
+
+#define THREAD_FLAG_DETACHED        (1 << 0)    // Recycled on exit
+#define THREAD_FLAG_IDLE            (1 << 1)    // A CPU's idle thread
+#define THREAD_FLAG_FPU             (1 << 2)    // Has extended state
+
+//----------------------------------------------------------------------------//
+// Thread - Structures
+//----------------------------------------------------------------------------//
+
+/**
+ * Thread control block.
+ */
+typedef struct thread_t
+{
+    /**
+     * The saved stack pointer while not running; the remaining context is
+     * saved on the thread's stack. Must be the first field.
+     */
+    uintptr_t sp;
+    
+    /**
+     * The thread's id.
+     */
+    thread_id_t id;
+    
+    /**
+     * The thread's state and flags.
+     */
+    uint8_t state;
+    uint8_t flags;
+    
+    /**
+     * Whether the thread's context is in use by a CPU; cleared once it has
+     * been saved after switching away.
+     */
+    volatile bool on_cpu;
+    
+    /**
+     * Lock protecting the thread's exit against joining and detaching.
+     */
+    spinlock_t lock;
+    
+    /**
+     * The thread's kernel stack. Empty for the boot context of a CPU.
+     */
+    stack_t stack;
+    
+    /**
+     * Buffer for the thread's FPU/SIMD state, allocated on first use, and the
+     * logical number of the CPU the state was last loaded on.
+     */
+    void *fpu;
+    uint32_t fpu_cpu;
+    
+    /**
+     * The value passed to <tt>thread_exit</tt>.
+     */
+    void *result;
+    
+    /**
+     * The thread waiting in <tt>thread_join</tt> for this one to exit.
+     */
+    struct thread_t *joiner;
+    
+    /**
+     * Pointer to the next thread in the overflow queue or pool.
+     */
+    struct thread_t *next;
+    
+} thread_t;
+
+//----------------------------------------------------------------------------//
+// Thread - Initialization
+//----------------------------------------------------------------------------//
+
+/**
+ * Turns the calling context into the first thread and creates the BSP's
+ * idle thread.
+ *
+ * Only to be called once on the BSP.
+ */
+void thread_init(void);
+
+/**
+ * Turns the calling context into the current CPU's idle thread and runs the
+ * idle loop. Does not return.
+ *
+ * To be called on each AP at the end of its startup.
+ */
+void thread_idle(void);
+
+//----------------------------------------------------------------------------//
+// Thread
+//----------------------------------------------------------------------------//
+
+/**
+ * Creates a kernel thread and queues it to run.
+ *
+ * @param entry The thread's entry point; returning from it exits the thread.
+ * @param arg The argument to pass to the entry point.
+ * @return The new thread.
+ */
+thread_t *thread_create(thread_entry_t entry, void *arg);
+
+/**
+ * Exits the calling thread. Does not return.
+ *
+ * @param result The value to return from <tt>thread_join</tt>.
+ */
+void thread_exit(void *result);
+
+/**
+ * Waits for the given thread to exit and releases it.
+ *
+ * At most one thread may join a thread; detached threads can not be joined.
+ *
+ * @param thread The thread to wait for.
+ * @return The value the thread passed to <tt>thread_exit</tt>.
+ */
+void *thread_join(thread_t *thread);
+
+/**
+ * Detaches the given thread, so it is released as soon as it exits.
+ *
+ * @param thread The thread to detach.
+ */
+void thread_detach(thread_t *thread);
+
+/**
+ * Gives up the CPU to the next ready thread, if any.
+ */
+void thread_yield(void);
+
+/**
+ * Returns the thread running on the current CPU.
+ *
+ * @return The current thread or a null-pointer, if threads are not set up.
+ */
+thread_t *thread_current(void);
@@ -32,13 +32,14 @@
 size_t strlen(const int8_t *str);
 
 /**
- * Compares the given strings and returns whether they are equal.
+ * Compares the given strings lexicographically (bytes compared as unsigned).
  *
  * @param a The first string.
  * @param b The second string.
- * @return <tt>1</tt> when equal, <tt>0</tt> otherwise.
+ * @return <tt>0</tt> when equal, a negative value if <tt>a</tt> sorts before
+ *  <tt>b</tt> and a positive value otherwise.
  */
-uint8_t strcmp(const int8_t *a, const int8_t *b);
+int strcmp(const int8_t *a, const int8_t *b);
 
 /**
  * Copies the given source string to the given destination.
@@ -72,6 +73,16 @@ int8_t *strstr(const int8_t *haystack, const int8_t *needle);
  */
 void memcpy(void *dest, void *src, size_t length);
 
+/**
+ * Copies <tt>n</tt> bytes from <tt>src</tt> to <tt>dest</tt>, where the memory
+ * chunks may overlap.
+ *
+ * @param dest The destination in memory.
+ * @param src The source in memory.
+ * @param length The length of the memory chunk to copy.
+ */
+void memmove(void *dest, void *src, size_t length);
+
 /**
  * Copies the given byte to the memory from <tt>dest</tt> to <tt>dest + length</tt>.
  *
@@ -96,5 +107,7 @@ uintptr_t mem_align(uintptr_t address, size_t boundary);
  * @param a First memory chunk.
  * @param b Second memory chunk.
  * @param len Length of memory chunk to compare.
+ * @return <tt>0</tt> when equal, otherwise the difference of the first pair
+ *  of differing bytes (compared as unsigned).
  */
-bool memcmp(void *a, void *b, size_t len);
+int memcmp(void *a, void *b, size_t len);
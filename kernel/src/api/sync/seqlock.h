@@ -0,0 +1,70 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+
+#pragma once
+#include <api/types.h>
+
+//----------------------------------------------------------------------------//
+// Types
+//----------------------------------------------------------------------------//
+
+/**
+ * A sequence lock: readers never block and retry if a writer interfered.
+ *
+ * Writers must be serialized by other means (e.g. by being the only writer).
+ */
+typedef struct seqlock_t
+{
+    volatile uint32_t sequence;
+} seqlock_t;
+
+//----------------------------------------------------------------------------//
+// Seqlock
+//----------------------------------------------------------------------------//
+
+/**
+ * Begins a read section, waiting for a running write section to end.
+ *
+ * @param lock The lock.
+ * @return The sequence number to pass to <tt>seqlock_read_retry</tt>.
+ */
+uint32_t seqlock_read_begin(seqlock_t *lock);
+
+/**
+ * Checks whether a read section has to be retried.
+ *
+ * @param lock The lock.
+ * @param sequence The sequence number returned by <tt>seqlock_read_begin</tt>.
+ * @return Whether a write section interfered with the read section.
+ */
+bool seqlock_read_retry(seqlock_t *lock, uint32_t sequence);
+
+/**
+ * Begins a write section.
+ *
+ * @param lock The lock.
+ */
+void seqlock_write_begin(seqlock_t *lock);
+
+/**
+ * Ends a write section.
+ *
+ * @param lock The lock.
+ */
+void seqlock_write_end(seqlock_t *lock);
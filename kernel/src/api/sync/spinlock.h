@@ -48,6 +48,14 @@ typedef struct spinlock_t
  */
 void spinlock_acquire(spinlock_t *lock);
 
+/**
+ * Tries to acquire the given spinlock without blocking.
+ *
+ * @param lock The lock to acquire.
+ * @return Whether the lock has been acquired.
+ */
+bool spinlock_try_acquire(spinlock_t *lock);
+
 /**
  * Releases the given spinlock.
  *
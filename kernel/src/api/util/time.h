@@ -39,6 +39,49 @@ typedef uint64_t time_t;
  */
 time_t time_current(void);
 
+/**
+ * Returns the time since the clocksource was started, in nanoseconds.
+ *
+ * Monotonic and consistent across CPUs; needs neither locks nor interrupts.
+ *
+ * @return Monotonic time in nanoseconds.
+ */
+uint64_t time_monotonic_ns(void);
+
+/**
+ * Returns the current UNIX time in nanoseconds.
+ *
+ * @return Nanoseconds since The Epoch.
+ */
+uint64_t time_realtime_ns(void);
+
+//----------------------------------------------------------------------------//
+// Time - Delays
+//----------------------------------------------------------------------------//
+
+/**
+ * Busy-waits for at least the given number of nanoseconds.
+ *
+ * Calibrated against the clocksource, so the duration does not depend on the
+ * CPU's speed. Usable before the clocksource is started, with a coarser
+ * resolution.
+ *
+ * @param ns The delay in nanoseconds.
+ */
+void ndelay(uint64_t ns);
+
+/**
+ * Busy-waits for at least the given number of microseconds.
+ *
+ * @param us The delay in microseconds.
+ * @see ndelay
+ */
+void udelay(uint64_t us);
+
+//----------------------------------------------------------------------------//
+// Time - Conversion
+//----------------------------------------------------------------------------//
+
 /**
  * Creates a UNIX timestamp out of the given UTC human-readable date (Gregorian
  * Calendar).
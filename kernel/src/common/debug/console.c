@@ -77,17 +77,17 @@ void console_print_dec(intptr_t number)
     }
     
     // Get characters in reverse order
-    uint32_t i = 0;
-    uint8_t out[16];
+    int32_t i = 0;
+    uint8_t out[20];
     
-    for (i = 15; number != 0; --i) {
-        uint32_t digit = number / 10;
-        number = number % 10;
+    for (i = 19; number != 0; --i) {
+        uint32_t digit = number % 10;
+        number = number / 10;
 
         out[i] = (int8_t) ('0' + digit);
     }
 
     // Print in correct order
-    for (++i; i < 16; ++i)
+    for (++i; i < 20; ++i)
         console_put(out[i]);
 }
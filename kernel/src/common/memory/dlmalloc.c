@@ -484,6 +484,7 @@ MAX_RELEASE_CHECK_RATE   default: 4095 unless not HAVE_MMAP
 #include <api/types.h>
 #include <api/debug/console.h>
 #include <api/memory/heap.h>
+#include <api/sync/spinlock.h>
 #include <common/memory/dlmalloc.h>
 
 void dlmalloc_abort() {}
@@ -1348,8 +1349,8 @@ extern void*     sbrk(uintptr_t);
 #endif /* FreeBSD etc */
 #endif /* LACKS_UNISTD_H */
 
-/* Declarations for locking */
-#if USE_LOCKS
+/* Declarations for locking (none for user-defined locks) */
+#if USE_LOCKS == 1
 #ifndef WIN32
 #include <pthread.h>
 #if defined (__SVR4) && defined (__sun)  /* solaris */
@@ -1894,12 +1895,24 @@ static void init_malloc_global_mutex() {
 /* -----------------------  User-defined locks ------------------------ */
 
 #if USE_LOCKS > 1
-/* Define your own lock implementation here */
-/* #define INITIAL_LOCK(sl)  ... */
-/* #define ACQUIRE_LOCK(sl)  ... */
-/* #define RELEASE_LOCK(sl)  ... */
-/* #define TRY_LOCK(sl) ... */
-/* static MLOCK_T malloc_global_mutex = ... */
+/* Kernel spinlocks; waiters handle TLB shootdowns of a holder unmapping */
+#define MLOCK_T               spinlock_t
+#define INITIAL_LOCK(sl)      kernel_init_lock(sl)
+#define ACQUIRE_LOCK(sl)      kernel_acquire_lock(sl)
+#define RELEASE_LOCK(sl)      spinlock_release(sl)
+#define TRY_LOCK(sl)          spinlock_try_acquire(sl)
+static SPINLOCK_INIT(malloc_global_mutex);
+
+static FORCEINLINE int kernel_init_lock (MLOCK_T *sl) {
+  sl->lock = 0;
+  sl->flags = 0;
+  return 0;
+}
+
+static FORCEINLINE int kernel_acquire_lock (MLOCK_T *sl) {
+  heap_lock_acquire(sl);
+  return 0;
+}
 #endif /* USE_LOCKS > 1 */
 
 /* -----------------------  Lock-based state ------------------------ */
@@ -27,8 +27,18 @@
 #define MORECORE heap_sbrk
 #define MORECORE_CANNOT_TRIM 1
 #define MORECORE_CONTIGUOUS 1
-#define HAVE_MMAP 0
+#define DEFAULT_GRANULARITY ((size_t) 2U * (size_t) 1024U * (size_t) 1024U)
+#define HAVE_MMAP 1
+#define HAVE_MREMAP 1
+#define MMAP(s) heap_mmap(s)
+#define DIRECT_MMAP(s) heap_mmap(s)
+#define MAP_ANONYMOUS 0x20 // heap_mmap is anonymous; avoids the /dev/zero path
+#define MUNMAP(a, s) heap_munmap((a), (s))
+#define MREMAP(a, osz, nsz, mv) heap_mremap((a), (osz), (nsz), (mv))
+#define MMAP_CLEARS 0
+#define DEFAULT_MMAP_THRESHOLD ((size_t) 128U * (size_t) 1024U)
 #define MALLOC_FAILURE_ACTION
+#define USE_LOCKS 2 // Spinlocks, see heap_lock_acquire
 
 #define LACKS_UNISTD_H 1
 #define LACKS_FCNTL_H 1
@@ -40,7 +50,9 @@
 #define LACKS_ERRNO_H
 #define LACKS_STDLIB_H
 
+#ifdef __DEBUG__
 #define DEBUG 1
 #define FOOTERS 1
+#endif
 
 
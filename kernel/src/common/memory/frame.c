@@ -19,6 +19,7 @@
 #include <api/types.h>
 #include <api/memory/frame.h>
 #include <api/string.h>
+#include <api/sync/spinlock.h>
 
 #include <api/debug/console.h>
 
@@ -31,6 +32,8 @@ static uintptr_t frame_length = 0;
 
 static uintptr_t *frame_bitset;
 
+static SPINLOCK_INIT(frame_lock);
+
 //----------------------------------------------------------------------------//
 // Macros
 //----------------------------------------------------------------------------//
@@ -60,7 +63,7 @@ static uintptr_t *frame_bitset;
  */
 static void _frame_set_alloc(uintptr_t frameNumber)
 {
-    frame_bitset[FRAME_INDEX(frameNumber)] |= 1 << FRAME_OFFSET(frameNumber);
+    frame_bitset[FRAME_INDEX(frameNumber)] |= (uintptr_t) 1 << FRAME_OFFSET(frameNumber);
 }
 
 /**
@@ -70,7 +73,7 @@ static void _frame_set_alloc(uintptr_t frameNumber)
  */
 static void _frame_set_free(uintptr_t frameNumber)
 {
-    frame_bitset[FRAME_INDEX(frameNumber)] &= ~(1 << FRAME_OFFSET(frameNumber));
+    frame_bitset[FRAME_INDEX(frameNumber)] &= ~((uintptr_t) 1 << FRAME_OFFSET(frameNumber));
 }
 
 /**
@@ -87,7 +90,7 @@ static uintptr_t _frame_find()
         if ((uintptr_t) (-1) != frame_bitset[index])
             // Check each frame
             for (offset = 0; offset < FRAME_MAX_OFFSET; ++offset)
-                if (0 == (frame_bitset[index] & (1 << offset)))
+                if (0 == (frame_bitset[index] & ((uintptr_t) 1 << offset)))
                     // Get frame number
                     return index * FRAME_MAX_OFFSET + offset;
     }
@@ -95,6 +98,38 @@ static uintptr_t _frame_find()
     return (uintptr_t) (-1);
 }
 
+/**
+ * Checks whether all frames in the given range are free.
+ *
+ * @param frameNumber The number of the first frame.
+ * @param count The number of frames.
+ * @return Whether all frames are free.
+ */
+static bool _frame_range_free(uintptr_t frameNumber, size_t count)
+{
+    uintptr_t end = frameNumber + count;
+    
+    while (frameNumber < end) {
+        // Check whole bunch at once?
+        if (0 == FRAME_OFFSET(frameNumber) && end - frameNumber >= FRAME_MAX_OFFSET) {
+            if (0 != frame_bitset[FRAME_INDEX(frameNumber)])
+                return false;
+                
+            frameNumber += FRAME_MAX_OFFSET;
+            
+        // Check single frame
+        } else {
+            if (frame_bitset[FRAME_INDEX(frameNumber)] &
+                ((uintptr_t) 1 << FRAME_OFFSET(frameNumber)))
+                return false;
+                
+            ++frameNumber;
+        }
+    }
+    
+    return true;
+}
+
 //----------------------------------------------------------------------------//
 // Implementation - Public
 //----------------------------------------------------------------------------//
@@ -122,11 +157,15 @@ void frame_mark_unavailable(uintptr_t frame)
         return;
         
     // Mark as allocated
+    spinlock_acquire(&frame_lock);
     _frame_set_alloc(FRAME_NUMBER(frame));
+    spinlock_release(&frame_lock);
 }
 
 uintptr_t frame_alloc()
 {
+    spinlock_acquire(&frame_lock);
+    
     // Find free frame
     uintptr_t num = _frame_find();
     
@@ -134,14 +173,43 @@ uintptr_t frame_alloc()
     if ((uintptr_t) (-1) != num) {
         // Mark as allocated
         _frame_set_alloc(num);
+        spinlock_release(&frame_lock);
         
         // Return address
         return FRAME_ADDRESS(num);
     }
-        
+    
+    spinlock_release(&frame_lock);
     return num;
 }
 
+uintptr_t frame_alloc_contiguous(size_t count, uintptr_t alignment)
+{
+    // First frame with the requested alignment
+    uintptr_t frame = mem_align(frame_offset, alignment);
+    
+    spinlock_acquire(&frame_lock);
+    
+    for (; frame + count * FRAME_SIZE <= frame_offset + frame_length; frame += alignment) {
+        uintptr_t num = FRAME_NUMBER(frame);
+        
+        // All frames free?
+        if (!_frame_range_free(num, count))
+            continue;
+            
+        // Mark as allocated
+        uintptr_t i;
+        for (i = num; i < num + count; ++i)
+            _frame_set_alloc(i);
+            
+        spinlock_release(&frame_lock);
+        return frame;
+    }
+    
+    spinlock_release(&frame_lock);
+    return (uintptr_t) (-1);
+}
+
 void frame_free(uintptr_t frame)
 {
     // Out of bounds?
@@ -149,5 +217,7 @@ void frame_free(uintptr_t frame)
         return;
         
     // Mark as free
+    spinlock_acquire(&frame_lock);
     _frame_set_free(FRAME_NUMBER(frame));
+    spinlock_release(&frame_lock);
 }
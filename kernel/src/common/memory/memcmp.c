@@ -19,15 +19,41 @@
 #include <api/types.h>
 #include <api/string.h>
 
+#include <common/memory/word.h>
+
 //----------------------------------------------------------------------------//
 // Implementation - Public
 //----------------------------------------------------------------------------//
 
-bool memcmp(void *a, void *b, size_t len)
+int memcmp(void *a, void *b, size_t len)
 {
-    size_t i;
-    for (i = 0; i < len; ++i)
-        if (((uint8_t *) a)[i] != ((uint8_t *) b)[i]) return 0;
+    const uint8_t *x = (const uint8_t *) a;
+    const uint8_t *y = (const uint8_t *) b;
+    
+    // Compare word-wise, if both chunks can be aligned the same way
+    if (0 == (((uintptr_t) x ^ (uintptr_t) y) & MEM_WORD_MASK)) {
+        // Compare bytes until aligned
+        for (; len > 0 && !MEM_WORD_ALIGNED(x); --len, ++x, ++y)
+            if (*x != *y)
+                return *x - *y;
+                
+        // Skip equal words
+        const mem_word_t *wx = (const mem_word_t *) x;
+        const mem_word_t *wy = (const mem_word_t *) y;
+        
+        for (; len >= MEM_WORD_SIZE && *wx == *wy; len -= MEM_WORD_SIZE) {
+            ++wx;
+            ++wy;
+        }
         
-    return 1;
+        x = (const uint8_t *) wx;
+        y = (const uint8_t *) wy;
+    }
+    
+    // Compare remaining bytes (including a differing word)
+    for (; len > 0; --len, ++x, ++y)
+        if (*x != *y)
+            return *x - *y;
+            
+    return 0;
 }
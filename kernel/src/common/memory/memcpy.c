@@ -19,14 +19,37 @@
 #include <api/types.h>
 #include <api/string.h>
 
+#include <common/memory/word.h>
+
 //----------------------------------------------------------------------------//
 // Implementation - Public
 //----------------------------------------------------------------------------//
 
 void memcpy(void *dest, void *src, size_t length)
 {
-    size_t i;
+    uint8_t *d = (uint8_t *) dest;
+    const uint8_t *s = (const uint8_t *) src;
+    
+    // Copy word-wise, if both pointers can be aligned the same way
+    if (0 == (((uintptr_t) d ^ (uintptr_t) s) & MEM_WORD_MASK)) {
+        // Copy bytes until aligned
+        while (length > 0 && !MEM_WORD_ALIGNED(d)) {
+            *d++ = *s++;
+            --length;
+        }
+        
+        // Copy words
+        mem_word_t *dw = (mem_word_t *) d;
+        const mem_word_t *sw = (const mem_word_t *) s;
+        
+        for (; length >= MEM_WORD_SIZE; length -= MEM_WORD_SIZE)
+            *dw++ = *sw++;
+            
+        d = (uint8_t *) dw;
+        s = (const uint8_t *) sw;
+    }
     
-    for (i = 0; i < length; ++i)
-        ((uint8_t *) dest)[i] = ((uint8_t *) src)[i];
+    // Copy remaining bytes
+    while (length-- > 0)
+        *d++ = *s++;
 }
@@ -0,0 +1,66 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <api/types.h>
+#include <api/string.h>
+
+#include <common/memory/word.h>
+
+//----------------------------------------------------------------------------//
+// Implementation - Public
+//----------------------------------------------------------------------------//
+
+void memmove(void *dest, void *src, size_t length)
+{
+    uint8_t *d = (uint8_t *) dest;
+    const uint8_t *s = (const uint8_t *) src;
+    
+    // Forward copy is safe if the destination is below the source or the
+    // chunks do not overlap
+    if (d <= s || d >= s + length) {
+        memcpy(dest, src, length);
+        return;
+    }
+    
+    // Copy backwards, beginning at the end
+    d += length;
+    s += length;
+    
+    // Copy word-wise, if both pointers can be aligned the same way
+    if (0 == (((uintptr_t) d ^ (uintptr_t) s) & MEM_WORD_MASK)) {
+        // Copy bytes until aligned
+        while (length > 0 && !MEM_WORD_ALIGNED(d)) {
+            *--d = *--s;
+            --length;
+        }
+        
+        // Copy words
+        mem_word_t *dw = (mem_word_t *) d;
+        const mem_word_t *sw = (const mem_word_t *) s;
+        
+        for (; length >= MEM_WORD_SIZE; length -= MEM_WORD_SIZE)
+            *--dw = *--sw;
+            
+        d = (uint8_t *) dw;
+        s = (const uint8_t *) sw;
+    }
+    
+    // Copy remaining bytes
+    while (length-- > 0)
+        *--d = *--s;
+}
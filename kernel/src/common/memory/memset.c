@@ -19,14 +19,32 @@
 #include <api/types.h>
 #include <api/string.h>
 
+#include <common/memory/word.h>
+
 //----------------------------------------------------------------------------//
 // Implementation - Public
 //----------------------------------------------------------------------------//
 
 void memset(void *dest, uint8_t c, size_t length)
 {
-    size_t i;
+    uint8_t *d = (uint8_t *) dest;
+    
+    // Set bytes until aligned
+    while (length > 0 && !MEM_WORD_ALIGNED(d)) {
+        *d++ = c;
+        --length;
+    }
+    
+    // Set words (byte replicated over the whole word)
+    mem_word_t word = MEM_WORD_ONES * c;
+    mem_word_t *dw = (mem_word_t *) d;
+    
+    for (; length >= MEM_WORD_SIZE; length -= MEM_WORD_SIZE)
+        *dw++ = word;
+        
+    // Set remaining bytes
+    d = (uint8_t *) dw;
     
-    for (i = 0; i < length; ++i)
-        ((uint8_t *) dest)[i] = c;
+    while (length-- > 0)
+        *d++ = c;
 }
@@ -19,15 +19,38 @@
 #include <api/types.h>
 #include <api/string.h>
 
+#include <common/memory/word.h>
+
 //----------------------------------------------------------------------------//
 // Implementation - Public
 //----------------------------------------------------------------------------//
 
-uint8_t strcmp(const int8_t *a, const int8_t *b)
+int strcmp(const int8_t *a, const int8_t *b)
 {
-    size_t i;
-    for (i = 0; 0 != a[i] || 0 != b[i]; ++i)
-        if (a[i] != b[i]) return 0;
+    const uint8_t *x = (const uint8_t *) a;
+    const uint8_t *y = (const uint8_t *) b;
+    
+    // Compare word-wise, if both strings can be aligned the same way
+    if (0 == (((uintptr_t) x ^ (uintptr_t) y) & MEM_WORD_MASK)) {
+        // Compare bytes until aligned
+        for (; !MEM_WORD_ALIGNED(x); ++x, ++y)
+            if (*x != *y || 0 == *x)
+                return *x - *y;
+                
+        // Skip equal words without a zero byte
+        const mem_word_t *wx = (const mem_word_t *) x;
+        const mem_word_t *wy = (const mem_word_t *) y;
+        
+        while (*wx == *wy && !MEM_WORD_HAS_ZERO(*wx)) {
+            ++wx;
+            ++wy;
+        }
         
-    return 1;
+        x = (const uint8_t *) wx;
+        y = (const uint8_t *) wy;
+    }
+    
+    // Compare remaining bytes
+    for (; *x == *y && 0 != *x; ++x, ++y);
+    return *x - *y;
 }
@@ -19,13 +19,27 @@
 #include <api/types.h>
 #include <api/string.h>
 
+#include <common/memory/word.h>
+
 //----------------------------------------------------------------------------//
 // Implementation - Public
 //----------------------------------------------------------------------------//
 
 size_t strlen(const int8_t *str)
 {
-    size_t len;
-    for (len = 0; 0 != str[len]; ++len);
-    return len;
+    const int8_t *s = str;
+    
+    // Check bytes until aligned
+    for (; !MEM_WORD_ALIGNED(s); ++s)
+        if (0 == *s)
+            return s - str;
+            
+    // Skip words without a zero byte (aligned reads never cross a page)
+    const mem_word_t *w = (const mem_word_t *) s;
+    while (!MEM_WORD_HAS_ZERO(*w))
+        ++w;
+        
+    // Find the zero byte in the last word
+    for (s = (const int8_t *) w; 0 != *s; ++s);
+    return s - str;
 }
@@ -20,28 +20,150 @@
 #include <api/string.h>
 
 //----------------------------------------------------------------------------//
-// Implementation - Public
+// Internal
 //----------------------------------------------------------------------------//
 
-int8_t *strstr(const int8_t *haystack, const int8_t *needle)
+#define STRSTR_MAX(a, b)    ((a) > (b) ? (a) : (b))
+
+/**
+ * Computes the maximal suffix of the needle with respect to the given byte
+ * ordering, as required by the two-way string matching algorithm.
+ *
+ * @param n The needle.
+ * @param l The length of the needle.
+ * @param reverse Whether to use the reversed byte ordering.
+ * @param period Returns the period of the maximal suffix.
+ * @return The position preceding the maximal suffix (may be <tt>-1</tt>).
+ */
+static size_t _strstr_max_suffix(
+    const uint8_t *n, size_t l, bool reverse, size_t *period)
 {
-    size_t str_pos, substr_pos;
-    substr_pos = 0;
+    size_t ip = (size_t) -1;    // Position preceding the maximal suffix
+    size_t jp = 0;              // Candidate suffix position
+    size_t k = 1;               // Offset within the current period
+    size_t p = 1;               // Period of the maximal suffix
     
-    if (0 == needle[0])
-        return haystack;
-    
-    for (str_pos = 0; 0 != haystack[str_pos]; ++str_pos) {
-        if (needle[substr_pos] == haystack[str_pos]) {
-            ++substr_pos;
+    while (jp + k < l) {
+        uint8_t a = n[ip + k];
+        uint8_t b = n[jp + k];
+        
+        if (a == b) {
+            // Advance through the period
+            if (k == p) {
+                jp += p;
+                k = 1;
+            } else {
+                ++k;
+            }
+            
+        } else if (reverse ? (a < b) : (a > b)) {
+            // Suffix at jp is smaller; extend the period
+            jp += k;
+            k = 1;
+            p = jp - ip;
             
-            if (0 == needle[substr_pos]) 
-                return (int8_t *)
-                    (((uintptr_t) haystack) + str_pos - substr_pos + 1);
         } else {
-            substr_pos = 0;
+            // Suffix at jp is larger; restart from there
+            ip = jp++;
+            k = p = 1;
         }
     }
     
-    return (int8_t *) 0;
+    *period = p;
+    return ip;
+}
+
+/**
+ * Finds the needle in the haystack using the two-way string matching algorithm
+ * by Crochemore and Perrin, which requires linear time and constant space.
+ *
+ * @param h The haystack.
+ * @param n The needle (at least two bytes long).
+ * @return The first occurence of the needle or a null-pointer.
+ */
+static const uint8_t *_strstr_two_way(const uint8_t *h, const uint8_t *n)
+{
+    // Length of the needle (the haystack must be at least as long)
+    size_t l;
+    for (l = 0; 0 != n[l] && 0 != h[l]; ++l);
+    
+    if (0 != n[l])
+        return 0;
+        
+    // Critical factorization: the longer of both maximal suffixes
+    size_t p, p_rev;
+    size_t ms = _strstr_max_suffix(n, l, false, &p);
+    size_t ms_rev = _strstr_max_suffix(n, l, true, &p_rev);
+    
+    if (ms_rev + 1 > ms + 1) {
+        ms = ms_rev;
+        p = p_rev;
+    }
+    
+    // Periodic needles remember how much of the left half already matched
+    size_t mem0;
+    
+    if (0 == memcmp((void *) n, (void *) (n + p), ms + 1)) {
+        mem0 = l - p;
+    } else {
+        mem0 = 0;
+        p = STRSTR_MAX(ms + 1, l - ms - 1) + 1;
+    }
+    
+    // Known end of the haystack (all bytes before it are non-zero)
+    const uint8_t *end = h + l;
+    size_t mem = 0;
+    size_t k;
+    
+    while (1) {
+        // Make sure the haystack is long enough for the current window
+        while (end < h + l) {
+            if (0 == *end)
+                return 0;
+            ++end;
+        }
+        
+        // Compare right half
+        for (k = STRSTR_MAX(ms + 1, mem); k < l && n[k] == h[k]; ++k);
+        
+        if (k < l) {
+            h += k - ms;
+            mem = 0;
+            continue;
+        }
+        
+        // Compare left half
+        for (k = ms + 1; k > mem && n[k - 1] == h[k - 1]; --k);
+        
+        if (k <= mem)
+            return h;
+            
+        h += p;
+        mem = mem0;
+    }
+}
+
+//----------------------------------------------------------------------------//
+// Implementation - Public
+//----------------------------------------------------------------------------//
+
+int8_t *strstr(const int8_t *haystack, const int8_t *needle)
+{
+    const uint8_t *h = (const uint8_t *) haystack;
+    const uint8_t *n = (const uint8_t *) needle;
+    
+    // Empty needle
+    if (0 == n[0])
+        return (int8_t *) h;
+        
+    // Single byte needle
+    if (0 == n[1]) {
+        for (; 0 != *h; ++h)
+            if (*h == n[0])
+                return (int8_t *) h;
+                
+        return (int8_t *) 0;
+    }
+    
+    return (int8_t *) _strstr_two_way(h, n);
 }
@@ -0,0 +1,53 @@
+/**
+ * Oxygen Operating System
+ * Copyright (C) 2011 Lukas Heidemann
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+
+#pragma once
+#include <api/types.h>
+#include <api/compiler.h>
+
+//----------------------------------------------------------------------------//
+// Word-wise Memory Access
+//----------------------------------------------------------------------------//
+
+/**
+ * Machine word used by the word-at-a-time memory and string routines.
+ *
+ * May alias any other type, so the routines can be inlined into (or link-time
+ * optimized together with) code accessing the same memory with other types.
+ */
+typedef uintptr_t MAY_ALIAS mem_word_t;
+
+#define MEM_WORD_SIZE       sizeof(mem_word_t)
+#define MEM_WORD_MASK       (MEM_WORD_SIZE - 1)
+
+/**
+ * Word with each byte set to <tt>0x01</tt> and <tt>0x80</tt> respectively.
+ */
+#define MEM_WORD_ONES       ((mem_word_t) -1 / 0xFF)
+#define MEM_WORD_HIGHS      (MEM_WORD_ONES * 0x80)
+
+/**
+ * Checks whether the given address is word aligned.
+ */
+#define MEM_WORD_ALIGNED(p) (0 == ((uintptr_t) (p) & MEM_WORD_MASK))
+
+/**
+ * Non-zero, iff any byte of the given word is zero.
+ */
+#define MEM_WORD_HAS_ZERO(w) (((w) - MEM_WORD_ONES) & ~(w) & MEM_WORD_HIGHS)